@@ -0,0 +1,83 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "aot.h"
+#include "guard.h"
+
+// Give the interpreter its own copy of the compiled program, so the usual
+// cleanup in interpreter_delete applies
+static int aot_load(Interpreter *interpreter, const AotProgram *compiled) {
+    Program *program = &interpreter->program;
+
+    program->code = malloc(compiled->length * sizeof(Op));
+    program->lines = malloc(compiled->length * sizeof(int));
+    program->constants = malloc((compiled->constant_count + 1) * sizeof(Value));
+    if (program->code == NULL || program->lines == NULL || program->constants == NULL) {
+        return -1;
+    }
+
+    memcpy(program->code, compiled->code, compiled->length * sizeof(Op));
+    memcpy(program->lines, compiled->lines, compiled->length * sizeof(int));
+    program->length = compiled->length;
+    program->capacity = compiled->length;
+    program->constant_capacity = compiled->constant_count + 1;
+
+    for (int i = 0; i < compiled->constant_count; i++) {
+        const char *digits = compiled->constants[i];
+        const int sign = digits[0] == '-' ? -1 : 1;
+        if (sign < 0) digits++;
+
+        program->constants[i] = value_from_decimal(NULL, sign, digits, (int)strlen(digits));
+        program->constant_count++;
+    }
+
+    // Same ids as when decoding, undefined labels are reported by name
+    for (int i = 0; i < compiled->label_count; i++) {
+        const char *name = compiled->labels[i];
+        if (lt_intern(&interpreter->labels, name, (int)strlen(name)) < 0) return -1;
+    }
+    return 0;
+}
+
+static void run_compiled(Interpreter *interpreter, void *context) {
+    const AotProgram *program = context;
+    program->run(interpreter);
+}
+
+// main() of a compiled program
+int aot_main(const AotProgram *program) {
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    Interpreter *interpreter = interpreter_new();
+    if (interpreter == NULL) {
+        fprintf(stderr, "Error creating interpreter\n");
+        return 1;
+    }
+
+    if (aot_load(interpreter, program) != 0) {
+        perror("Error allocating memory");
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    // Same defaults as the interpreter with --flush=auto
+    interpreter->output.policy = isatty(STDOUT_FILENO) ? FLUSH_LINE : FLUSH_FULL;
+    interpreter->input.interactive = isatty(STDIN_FILENO);
+
+    interpreter->pc = 0;
+    interpreter->running = true;
+    guard_run(interpreter, run_compiled, (void *)program);
+    output_flush(&interpreter->output);
+
+    if (interpreter->input.error) {
+        fprintf(stderr, "Error reading from stdin\n");
+    }
+
+    interpreter_delete(interpreter);
+    return 0;
+}
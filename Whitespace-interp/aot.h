@@ -0,0 +1,180 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef AOT_H
+#define AOT_H
+
+// Runtime of programs compiled ahead of time with --emit-c (see emit.c).
+// A generated file holds the decoded program and a run function made of
+// one labelled macro per instruction; the macros below are the fast paths
+// of t_interpreter.c, everything else goes through the reference handlers
+// so messages and behaviour match the interpreter.
+
+#include "interpreter.h"
+#include "instruction.h"
+
+typedef struct {
+    const char* name;               // Source file the program came from
+    const Op* code;
+    const int* lines;
+    int length;
+    const char* const* constants;   // push_const numbers in decimal
+    int constant_count;
+    const char* const* labels;      // Label names by id, for error messages
+    int label_count;
+    void (*run)(Interpreter* interpreter);
+} AotProgram;
+
+int aot_main(const AotProgram *program);
+
+// Labels-as-values where available, a switch over every slot otherwise
+#ifdef __GNUC__
+    #define AOT_COMPUTED_GOTO
+    #define AOT_DISPATCH(pc) goto *aot_slots[(pc)]
+#else
+    #define AOT_DISPATCH(pc) do { aot_target = (pc); goto aot_dispatch; } while (0)
+#endif
+
+// Locals of the run function, laid out like the threaded loop: sp points
+// at the top slot and the top value itself lives in tos (the slot is stale)
+#define AOT_ENTER()                                         \
+    Stack *stack = interpreter->stack;                      \
+    Stack *call_stack = interpreter->call_stack;            \
+    const Heap *heap = &interpreter->heap;                  \
+    const Value *constants = interpreter->program.constants;\
+    Value *data = stack->data;                              \
+    Value *sp = data + stack->top;                          \
+    Value *limit = data + stack->capacity - 1;              \
+    Value tos = *sp;                                        \
+    (void)call_stack; (void)heap; (void)constants; (void)limit
+
+#define AOT_SPILL()     do { *sp = tos; stack->top = (int)(sp - data); } while (0)
+#define AOT_RELOAD()    do { data = stack->data; sp = data + stack->top; limit = data + stack->capacity - 1; tos = *sp; } while (0)
+// Fewer than n values on the stack
+#define AOT_SHORT(n)    (sp < data + ((n) - 1))
+#define AOT_AT(n)       ((n) == 0 ? tos : sp[-(n)])
+#define AOT_PUSH_FAST(v) do { const Value pushed = (v); *sp++ = tos; tos = pushed; } while (0)
+#define AOT_DROP(n)     do { sp -= (n); tos = *sp; } while (0)
+#define AOT_SMALL(n)    value_from_small(n)
+#define AOT_CELL(v)     (value_is_small(v) ? heap_find(heap, (uintptr_t)value_small(v)) : NULL)
+
+// Copy and slide counts above this always take the slow path
+#define AOT_MAX_DEPTH   (1 << 20)
+
+#ifdef __GNUC__
+    #define AOT_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+    #define AOT_UNLIKELY(x) (x)
+#endif
+
+// At least n values on the stack, proven when the program was decoded
+// (verify.c). Lets the C compiler drop the AOT_SHORT tests of the slot
+#ifdef __GNUC__
+    #define AOT_PROVEN(n)   do { if (AOT_SHORT(n)) __builtin_unreachable(); } while (0)
+#else
+    #define AOT_PROVEN(n)   ((void)0)
+#endif
+
+// Run slot i through its reference handler, then go on where it left pc
+#define AOT_SLOW(i) do {                                    \
+        AOT_SPILL();                                        \
+        interpreter->pc = (i) + 1;                          \
+        handler_table[aot_code[(i)].opcode](interpreter, aot_code[(i)].operand); \
+        AOT_RELOAD();                                       \
+        if (!interpreter->running) goto aot_halt;           \
+        if (interpreter->pc != (i) + 1) AOT_DISPATCH(interpreter->pc); \
+    } while (0)
+
+#define AOT_PUSH_VALUE(i, v) do {                           \
+        if (AOT_UNLIKELY(sp >= limit)) AOT_SLOW(i);         \
+        else AOT_PUSH_FAST(v);                              \
+    } while (0)
+
+#define AOT_PUSH(i, n)          AOT_PUSH_VALUE(i, AOT_SMALL(n))
+#define AOT_PUSH_CONST(i, k)    AOT_PUSH_VALUE(i, constants[(k)])
+
+#define AOT_COPY(i, n) do {                                 \
+        if (AOT_UNLIKELY(AOT_SHORT((n) + 1) || sp >= limit)) AOT_SLOW(i); \
+        else AOT_PUSH_FAST(AOT_AT(n));                      \
+    } while (0)
+
+#define AOT_SLIDE(i, n) do {                                \
+        if (AOT_UNLIKELY(AOT_SHORT((n) + 1))) AOT_SLOW(i);  \
+        else sp -= (n);                                     \
+    } while (0)
+
+#define AOT_DUP(i) do {                                     \
+        if (AOT_UNLIKELY(AOT_SHORT(1) || sp >= limit)) AOT_SLOW(i); \
+        else AOT_PUSH_FAST(tos);                            \
+    } while (0)
+
+#define AOT_SWAP(i) do {                                    \
+        if (AOT_UNLIKELY(AOT_SHORT(2))) AOT_SLOW(i);        \
+        else { const Value a = tos; tos = sp[-1]; sp[-1] = a; } \
+    } while (0)
+
+#define AOT_DISCARD(i) do {                                 \
+        if (AOT_UNLIKELY(AOT_SHORT(1))) AOT_SLOW(i);        \
+        else AOT_DROP(1);                                   \
+    } while (0)
+
+// Tagged arithmetic on sp[-1] and tos, see OP_ADD and friends in t_interpreter.c
+#define AOT_ARITH(i, overflows) do {                        \
+        Value result;                                       \
+        if (AOT_UNLIKELY(AOT_SHORT(2) || !value_is_small(sp[-1] | tos) || (overflows))) AOT_SLOW(i); \
+        else { sp--; tos = result; }                        \
+    } while (0)
+
+#define AOT_ADD(i)  AOT_ARITH(i, VALUE_ADD_OVERFLOW(sp[-1], tos, &result))
+#define AOT_SUB(i)  AOT_ARITH(i, VALUE_SUB_OVERFLOW(sp[-1], tos, &result))
+#define AOT_MUL(i)  AOT_ARITH(i, VALUE_MUL_OVERFLOW(value_small(sp[-1]), tos, &result))
+#define AOT_DIV(i)  AOT_ARITH(i, tos == 0 || tos == AOT_SMALL(-1) || \
+                              (result = AOT_SMALL(value_small(sp[-1]) / value_small(tos)), false))
+#define AOT_MOD(i)  AOT_ARITH(i, tos == 0 || (result = sp[-1] % tos, false))
+
+#define AOT_STORE(i) do {                                   \
+        Value *cell;                                        \
+        if (AOT_UNLIKELY(AOT_SHORT(2) || (cell = AOT_CELL(sp[-1])) == NULL)) AOT_SLOW(i); \
+        else { *cell = tos; AOT_DROP(2); }                  \
+    } while (0)
+
+#define AOT_RETRIEVE(i) do {                                \
+        const Value *cell;                                  \
+        if (AOT_UNLIKELY(AOT_SHORT(1) || (cell = AOT_CELL(tos)) == NULL)) AOT_SLOW(i); \
+        else tos = *cell;                                   \
+    } while (0)
+
+#define AOT_CALL(i, target) do {                            \
+        if (AOT_UNLIKELY(call_stack->top >= call_stack->capacity - 1)) AOT_SLOW(i); \
+        else { call_stack->data[++call_stack->top] = (i) + 1; goto target; } \
+    } while (0)
+
+#define AOT_JUMP(target)        goto target
+
+#define AOT_JZ(i, target) do {                              \
+        if (AOT_UNLIKELY(AOT_SHORT(1))) AOT_SLOW(i);        \
+        else { const Value v = tos; AOT_DROP(1); if (v == AOT_SMALL(0)) goto target; } \
+    } while (0)
+
+#define AOT_JN(i, target) do {                              \
+        if (AOT_UNLIKELY(AOT_SHORT(1))) AOT_SLOW(i);        \
+        else { const Value v = tos; AOT_DROP(1); if (value_is_negative(v)) goto target; } \
+    } while (0)
+
+#define AOT_RET(i) do {                                     \
+        if (AOT_UNLIKELY(call_stack->top < 0)) AOT_SLOW(i); \
+        else AOT_DISPATCH(call_stack->data[call_stack->top--]); \
+    } while (0)
+
+#define AOT_END(i) do {                                     \
+        interpreter->pc = (i) + 1;                          \
+        goto aot_halt;                                      \
+    } while (0)
+
+#define AOT_LEAVE() do {                                    \
+        AOT_SPILL();                                        \
+        interpreter->running = false;                       \
+    } while (0)
+
+#endif //AOT_H
@@ -0,0 +1,451 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// --batch: many independent programs in one process. A manifest lists one
+// job per line,
+//
+//     # program      input        output
+//     fact.ws        fact.in      fact.out
+//     count.ws       -            -
+//
+// separated by spaces or tabs; input - runs without input, output - goes
+// to stdout. Paths are taken as they are, relative to the working
+// directory. Every job gets its own interpreter and collects its output in
+// memory, which is written in one piece when the job ends, so jobs never
+// interleave. Errors go to stderr with the manifest line in front.
+//
+// Jobs are dealt round robin into one deque per worker. A worker takes
+// from the bottom of its own deque and, once that is empty, steals from
+// the top of the others (Chase-Lev). Nothing is pushed after the workers
+// start, so a worker whose steals all come back empty is done.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "batch.h"
+#include "whitespace.h"
+
+#define DEQUE_EMPTY (-1)
+#define DEQUE_ABORT (-2)
+
+typedef struct {
+    const char *program;
+    const char *input;      // NULL: no input
+    const char *output;     // NULL: stdout
+    int line;               // In the manifest
+} BatchJob;
+
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    int *jobs;              // Sized for every job, so it never wraps
+} Deque;
+
+typedef struct {
+    const char *manifest;
+    BatchJob *jobs;
+    int job_count;
+    bool fuse;
+    int optimize;
+    bool jit;
+
+    Deque *deques;
+    int worker_count;
+    atomic_int failed;
+    pthread_mutex_t report;     // stdout and stderr, one job at a time
+} Batch;
+
+typedef struct {
+    Batch *batch;
+    int index;
+} Worker;
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+// user of the job's WsIO
+typedef struct {
+    const char *input;
+    size_t input_length;
+    size_t input_position;
+    Buffer output;
+    Buffer errors;
+} JobContext;
+
+// Owner only, before the workers start
+static void deque_push(Deque *deque, const int job) {
+    const long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    deque->jobs[bottom] = job;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+// Owner only
+static int deque_pop(Deque *deque) {
+    const long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return DEQUE_EMPTY;
+    }
+
+    int job = deque->jobs[bottom];
+    if (top == bottom) {
+        // Last one, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            job = DEQUE_EMPTY;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+// Any thread. DEQUE_ABORT when another thread took the job first
+static int deque_steal(Deque *deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) return DEQUE_EMPTY;
+
+    const int job = deque->jobs[top];
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return DEQUE_ABORT;
+    }
+    return job;
+}
+
+static int batch_steal(Batch *batch, const int thief) {
+    for (int i = 1; i < batch->worker_count; i++) {
+        Deque *victim = &batch->deques[(thief + i) % batch->worker_count];
+
+        int job;
+        do {
+            job = deque_steal(victim);
+        } while (job == DEQUE_ABORT);
+
+        if (job != DEQUE_EMPTY) return job;
+    }
+    return DEQUE_EMPTY;
+}
+
+static int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+static char* read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = length >= 0 ? malloc((size_t)length + 1) : NULL;
+    if (data == NULL || fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    data[length] = '\0';
+    *size = (size_t)length;
+    fclose(file);
+    return data;
+}
+
+static size_t buffer_append(Buffer *buffer, const char *data, const size_t size) {
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity < buffer->length + size) capacity *= 2;
+
+        char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL) return 0;
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+    return size;
+}
+
+static ptrdiff_t job_read(void *user, char *buffer, size_t size) {
+    JobContext *context = user;
+    const size_t left = context->input_length - context->input_position;
+    if (size > left) size = left;
+    if (size == 0) return 0;
+
+    memcpy(buffer, context->input + context->input_position, size);
+    context->input_position += size;
+    return (ptrdiff_t)size;
+}
+
+static size_t job_write(void *user, const char *data, const size_t size) {
+    return buffer_append(&((JobContext*)user)->output, data, size);
+}
+
+static size_t job_error(void *user, const char *data, const size_t size) {
+    return buffer_append(&((JobContext*)user)->errors, data, size);
+}
+
+// Under the report lock
+static void job_report(const Batch *batch, const BatchJob *job, const char *format, const char *argument) {
+    fprintf(stderr, "%s:%d: ", batch->manifest, job->line);
+    fprintf(stderr, format, argument);
+    fputc('\n', stderr);
+}
+
+static bool job_write_output(Batch *batch, const BatchJob *job, const Buffer *output) {
+    if (job->output == NULL) {
+        if (output->length == 0) return true;
+
+        pthread_mutex_lock(&batch->report);
+        fwrite(output->data, 1, output->length, stdout);
+        pthread_mutex_unlock(&batch->report);
+        return true;
+    }
+
+    FILE *file = fopen(job->output, "wb");
+    if (file == NULL) return false;
+
+    const bool written = output->length == 0 || fwrite(output->data, 1, output->length, file) == output->length;
+    return fclose(file) == 0 && written;
+}
+
+static bool batch_job(Batch *batch, const BatchJob *job) {
+    JobContext context = {0};
+    const char *problem = NULL;
+    const char *subject = NULL;
+    WsStatus status = WS_FAILED;
+
+    size_t source_length = 0;
+    char *source = read_file(job->program, &source_length);
+    char *input = NULL;
+    if (source == NULL) {
+        problem = "Error reading %s";
+        subject = job->program;
+    } else if (job->input && (input = read_file(job->input, &context.input_length)) == NULL) {
+        problem = "Error reading %s";
+        subject = job->input;
+    }
+
+    if (problem == NULL) {
+        context.input = input;
+
+        WsInterpreter *ws = ws_new();
+        if (ws == NULL) {
+            problem = "Error creating interpreter for %s";
+            subject = job->program;
+        } else {
+            ws_set_options(ws, &(WsOptions){batch->fuse, batch->optimize, batch->jit});
+            ws_set_io(ws, &(WsIO){job_read, job_write, job_error, &context});
+
+            if (ws_load(ws, source, source_length) != 0) {
+                problem = "Error loading %s";
+                subject = job->program;
+            } else {
+                status = ws_run(ws, 0);
+            }
+            ws_delete(ws);
+        }
+    }
+
+    // Whatever the program wrote before an error is kept
+    if (problem == NULL && !job_write_output(batch, job, &context.output)) {
+        problem = "Error writing %s";
+        subject = job->output;
+    }
+
+    if (problem != NULL || context.errors.length > 0) {
+        pthread_mutex_lock(&batch->report);
+        // Every line of the messages, load diagnostics and runtime errors
+        const char *line = context.errors.data;
+        const char *end = line + context.errors.length;
+        while (line < end) {
+            const char *newline = memchr(line, '\n', (size_t)(end - line));
+            const char *next = newline ? newline + 1 : end;
+            fprintf(stderr, "%s:%d: ", batch->manifest, job->line);
+            fwrite(line, 1, (size_t)(next - line), stderr);
+            if (newline == NULL) fputc('\n', stderr);
+            line = next;
+        }
+        if (problem != NULL) {
+            job_report(batch, job, problem, subject);
+        }
+        pthread_mutex_unlock(&batch->report);
+    }
+
+    free(context.output.data);
+    free(context.errors.data);
+    free(input);
+    free(source);
+    return problem == NULL && status == WS_DONE;
+}
+
+static void* batch_worker(void *argument) {
+    const Worker *worker = argument;
+    Batch *batch = worker->batch;
+
+    for (;;) {
+        int job = deque_pop(&batch->deques[worker->index]);
+        if (job == DEQUE_EMPTY) job = batch_steal(batch, worker->index);
+        if (job == DEQUE_EMPTY) break;
+
+        if (!batch_job(batch, &batch->jobs[job])) {
+            atomic_fetch_add(&batch->failed, 1);
+        }
+    }
+    return NULL;
+}
+
+// Split the manifest into jobs in place, fields end up as strings inside text
+static int parse_manifest(Batch *batch, char *text) {
+    int capacity = 0;
+    int line = 0;
+
+    for (char *next = text; next != NULL && *next != '\0';) {
+        char *start = next;
+        char *end = strchr(start, '\n');
+        next = end ? end + 1 : NULL;
+        if (end) *end = '\0';
+        line++;
+
+        char *fields[4];
+        int count = 0;
+        for (char *field = strtok(start, " \t\r"); field != NULL; field = strtok(NULL, " \t\r")) {
+            if (count == 0 && field[0] == '#') break;
+            if (count < 4) fields[count] = field;
+            count++;
+        }
+        if (count == 0) continue;
+
+        if (count != 3) {
+            fprintf(stderr, "%s:%d: Expected program, input and output\n", batch->manifest, line);
+            return -1;
+        }
+
+        if (batch->job_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            BatchJob *jobs = realloc(batch->jobs, capacity * sizeof(BatchJob));
+            if (jobs == NULL) {
+                perror("Error allocating memory");
+                return -1;
+            }
+            batch->jobs = jobs;
+        }
+
+        batch->jobs[batch->job_count++] = (BatchJob){
+            fields[0],
+            strcmp(fields[1], "-") == 0 ? NULL : fields[1],
+            strcmp(fields[2], "-") == 0 ? NULL : fields[2],
+            line
+        };
+    }
+    return 0;
+}
+
+int batch_run(const char *manifest, int threads, const bool fuse, const int optimize, const bool jit) {
+    Batch batch = {0};
+    batch.manifest = manifest;
+    batch.fuse = fuse;
+    batch.optimize = optimize;
+    batch.jit = jit;
+
+    size_t size;
+    char *text = read_file(manifest, &size);
+    if (text == NULL) {
+        perror("Error reading manifest");
+        return -1;
+    }
+
+    if (parse_manifest(&batch, text) != 0) {
+        free(batch.jobs);
+        free(text);
+        return -1;
+    }
+
+    if (threads <= 0) threads = cpu_count();
+    if (threads > batch.job_count) threads = batch.job_count;
+    batch.worker_count = threads;
+
+    batch.deques = calloc(threads, sizeof(Deque));
+    Worker *workers = malloc(threads * sizeof(Worker));
+    pthread_t *handles = malloc(threads * sizeof(pthread_t));
+    int *slots = malloc(batch.job_count * sizeof(int));
+    if ((threads > 0 && (batch.deques == NULL || workers == NULL || handles == NULL)) ||
+        (batch.job_count > 0 && slots == NULL)) {
+        perror("Error allocating memory");
+        free(slots);
+        free(handles);
+        free(workers);
+        free(batch.deques);
+        free(batch.jobs);
+        free(text);
+        return -1;
+    }
+
+    // Each deque gets the slice of slots it can ever hold
+    int offset = 0;
+    for (int w = 0; w < threads; w++) {
+        atomic_init(&batch.deques[w].top, 0);
+        atomic_init(&batch.deques[w].bottom, 0);
+        batch.deques[w].jobs = slots + offset;
+        offset += (batch.job_count - w + threads - 1) / threads;
+    }
+    for (int i = 0; i < batch.job_count; i++) {
+        deque_push(&batch.deques[i % threads], i);
+    }
+
+    atomic_init(&batch.failed, 0);
+    pthread_mutex_init(&batch.report, NULL);
+
+    // Worker 0 is this thread
+    int started = 1;
+    for (int w = 0; w < threads; w++) {
+        workers[w] = (Worker){&batch, w};
+    }
+    for (int w = 1; w < threads; w++, started++) {
+        if (pthread_create(&handles[w], NULL, batch_worker, &workers[w]) != 0) break;
+    }
+    if (threads > 0) batch_worker(&workers[0]);
+    for (int w = 1; w < started; w++) {
+        pthread_join(handles[w], NULL);
+    }
+
+    pthread_mutex_destroy(&batch.report);
+    const int failed = atomic_load(&batch.failed);
+    if (failed > 0) {
+        fprintf(stderr, "%d of %d jobs failed\n", failed, batch.job_count);
+    }
+
+    free(slots);
+    free(handles);
+    free(workers);
+    free(batch.deques);
+    free(batch.jobs);
+    free(text);
+    return failed;
+}
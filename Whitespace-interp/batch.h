@@ -0,0 +1,15 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+
+// Run every job of a manifest on threads workers (0: one per CPU). fuse,
+// optimize (the -O level) and jit as for a single run. Returns the number of jobs that failed, or
+// -1 if the manifest cannot be read
+int batch_run(const char *manifest, int threads, bool fuse, int optimize, bool jit);
+
+#endif //BATCH_H
@@ -0,0 +1,477 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Compiled-program cache (.wsc): the decoded program as it sits in memory,
+// so a warm start maps the file and points the program at it instead of
+// decoding. Layout, native byte order:
+//   CacheHeader
+//   code: length Ops, then lines: length ints
+//   constants at constants_offset: sign, limb count, limbs (int32 each)
+//   labels at labels_offset: position, length (int32 each), the name
+//   padded to 4 bytes
+//   with --pre-eval, a snapshot at snapshot_offset: its output, then its
+//   state (see preeval.h)
+// The cache is keyed on the source (length and hash) and on the build
+// (cache_layout), and only fits the fusion setting and -O level it was
+// written with. Sources the decoder warned about are not cached, a warm
+// start would not repeat the warnings.
+
+// mmap and friends are not part of strict C modes
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+#include "cache.h"
+#include "instruction.h"
+#include "fusion.h"
+#include "verify.h"
+#include "jit.h"
+
+#define CACHE_MAGIC "WSPC"
+#define CACHE_VERSION 3
+#define CACHE_FUSED 1
+// The -O level sits above the fusion bit
+#define CACHE_LEVEL_SHIFT 1
+
+#define ALIGN4(n) (((n) + 3) & ~(uint64_t)3)
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t layout;            // cache_layout() of the build that wrote it
+    uint64_t source_length;
+    uint64_t source_hash;
+    uint32_t flags;             // CACHE_FUSED, -O level << CACHE_LEVEL_SHIFT
+    int32_t length;             // Slots in code and lines, which follow
+    int32_t constant_count;
+    int32_t label_count;
+    uint64_t constants_offset;
+    uint64_t labels_offset;
+    uint64_t snapshot_offset;   // 0 if the program was not pre-evaluated
+    uint64_t snapshot_output;   // Bytes of output, then of state
+    uint64_t snapshot_state;
+    uint64_t snapshot_finished;
+    uint64_t size;              // Of the whole file
+} CacheHeader;
+
+static void hash_bytes(uint64_t *hash, const void *data, const size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        *hash ^= bytes[i];
+        *hash *= 1099511628211u;
+    }
+}
+
+// Identifies what a cache written by this build looks like: byte order,
+// sizes and opcode numbering
+static uint64_t cache_layout(void) {
+    uint64_t hash = 14695981039346656037u;
+    const uint32_t probe[] = {0x01020304u, (uint32_t)sizeof(Op), (uint32_t)sizeof(int), OP_COUNT};
+    hash_bytes(&hash, probe, sizeof(probe));
+
+    for (int i = 0; i < OP_COUNT; i++) {
+        hash_bytes(&hash, opcode_names[i], strlen(opcode_names[i]) + 1);
+    }
+    return hash;
+}
+
+// prog.ws -> prog.wsc, anything else gets .wsc appended
+char* cache_path_for(const char *source) {
+    const size_t length = strlen(source);
+    const bool ws = length >= 3 && strcmp(source + length - 3, ".ws") == 0;
+
+    char *path = malloc(length + 5);
+    if (path == NULL) return NULL;
+
+    memcpy(path, source, length);
+    strcpy(path + length, ws ? "c" : ".wsc");
+    return path;
+}
+
+// MAPPING
+
+// Private and writable: pages stay shared with the file until written to
+static uint8_t* map_file(const char *path, size_t *size) {
+#ifdef _WIN32
+    // Read instead, a view of the file cannot be released with free
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = length > 0 ? malloc((size_t)length) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = (size_t)length;
+    return data;
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    *size = (size_t)info.st_size;
+    return data;
+#endif
+}
+
+static void unmap_file(void *data, const size_t size) {
+#ifdef _WIN32
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+void cache_release(Program *program) {
+    if (program->mapping == NULL) return;
+
+    unmap_file(program->mapping, program->mapping_size);
+    program->mapping = NULL;
+    program->mapping_size = 0;
+    program->code = NULL;
+    program->lines = NULL;
+    program->length = 0;
+    program->capacity = 0;
+}
+
+// LOADING
+
+// Operands of a cached program point where the engines expect them to,
+// and its lines are lines of a source of source_length bytes
+static bool cache_check_code(const Program *program, const int label_count, const uint64_t source_length) {
+    if (program->code[program->length - 1].opcode != OP_END) return false;
+
+    for (int i = 0; i < program->length; i++) {
+        const Op *op = &program->code[i];
+        if (op->opcode >= OP_COUNT || !fusion_intact(program, i)) return false;
+        if (program->lines[i] < 1 || (uint64_t)program->lines[i] > source_length + 1) return false;
+
+        switch (fusion_first(op->opcode)) {
+            case OP_CALL:
+            case OP_JUMP:
+            case OP_JZ:
+            case OP_JN:
+                // Undefined labels are -(id + 1)
+                if (op->operand >= program->length || op->operand < -label_count) return false;
+                break;
+            case OP_PUSH_CONST:
+                if (op->operand < 0 || op->operand >= program->constant_count) return false;
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+static bool cache_read_constants(Program *program, const uint8_t *data, uint64_t offset, const uint64_t end,
+                                 const int count) {
+    program->constants = malloc((count + 1) * sizeof(Value));
+    if (program->constants == NULL) return false;
+    program->constant_capacity = count + 1;
+
+    for (int i = 0; i < count; i++) {
+        if (end - offset < 8) return false;
+
+        int32_t record[2];
+        memcpy(record, data + offset, sizeof(record));
+        offset += 8;
+        if (record[1] < 0 || (end - offset) / 4 < (uint64_t)record[1]) return false;
+
+        program->constants[i] = value_from_limbs(NULL, record[0], (const uint32_t *)(data + offset), record[1]);
+        program->constant_count++;
+        offset += 4 * (uint64_t)record[1];
+    }
+    return true;
+}
+
+// Labels of a program of length slots
+static bool cache_read_labels(LabelTable *labels, const uint8_t *data, uint64_t offset, const uint64_t end,
+                              const int count, const int length) {
+    for (int i = 0; i < count; i++) {
+        if (end - offset < 8) return false;
+
+        int32_t record[2];
+        memcpy(record, data + offset, sizeof(record));
+        offset += 8;
+        if (record[1] < 0 || end - offset < ALIGN4((uint64_t)record[1])) return false;
+        // A slot of the program, -1 for a label no mark defines
+        if (record[0] < -1 || record[0] > length) return false;
+
+        // Every name once, in id order
+        if (lt_intern(labels, (const char *)(data + offset), record[1]) != i) return false;
+        labels->entries[i].position = record[0];
+        offset += ALIGN4((uint64_t)record[1]);
+    }
+    return true;
+}
+
+// Copy of the snapshot in a cache, empty if the copy fails
+static void cache_read_snapshot(Snapshot *snapshot, const uint8_t *data, const CacheHeader *header) {
+    *snapshot = (Snapshot){0};
+    snapshot->finished = header->snapshot_finished != 0;
+    snapshot->output_size = header->snapshot_output;
+    snapshot->state_size = header->snapshot_state;
+
+    const uint8_t *output = data + header->snapshot_offset;
+    if (snapshot->output_size > 0 && (snapshot->output = malloc(snapshot->output_size)) != NULL) {
+        memcpy(snapshot->output, output, snapshot->output_size);
+    }
+    if (snapshot->state_size > 0 && (snapshot->state = malloc(snapshot->state_size)) != NULL) {
+        memcpy(snapshot->state, output + snapshot->output_size, snapshot->state_size);
+    }
+
+    if ((snapshot->output_size > 0 && snapshot->output == NULL) ||
+        (snapshot->state_size > 0 && snapshot->state == NULL)) {
+        snapshot_free(snapshot);
+    }
+}
+
+// Make the mapped cache the program of interpreter if it was made from the
+// loaded source. On success the program owns data, and a snapshot in the
+// cache is copied to snapshot if that is not NULL, setting *snapshotted
+static bool cache_use(Interpreter *interpreter, uint8_t *data, const size_t size, Snapshot *snapshot,
+                      bool *snapshotted) {
+    if (size < sizeof(CacheHeader)) return false;
+
+    const CacheHeader *header = (const CacheHeader *)data;
+    if (memcmp(header->magic, CACHE_MAGIC, 4) != 0 || header->version != CACHE_VERSION ||
+        header->layout != cache_layout() || header->size != size ||
+        ((header->flags & CACHE_FUSED) != 0) != interpreter->fuse ||
+        header->flags >> CACHE_LEVEL_SHIFT != (uint32_t)interpreter->optimize ||
+        header->source_length != (uint64_t)interpreter->parser.length ||
+        header->source_hash != interpreter_source_hash(interpreter)) {
+        return false;
+    }
+
+    const uint64_t length = (uint64_t)header->length;
+    const uint64_t lines_offset = sizeof(CacheHeader) + length * sizeof(Op);
+    const uint64_t lines_end = lines_offset + length * sizeof(int);
+    if (header->length < 1 || header->constant_count < 0 || header->label_count < 0 ||
+        length > size / (sizeof(Op) + sizeof(int)) || lines_end > size ||
+        header->constants_offset < lines_end || header->constants_offset % 4 != 0 ||
+        header->labels_offset < header->constants_offset || header->labels_offset % 4 != 0 ||
+        header->labels_offset > size) {
+        return false;
+    }
+
+    // The snapshot, if any, ends the file
+    const uint64_t labels_end = header->snapshot_offset ? header->snapshot_offset : size;
+    if (header->snapshot_offset != 0 &&
+        (header->snapshot_offset < header->labels_offset || header->snapshot_offset > size ||
+         header->snapshot_output > size - header->snapshot_offset ||
+         header->snapshot_state != size - header->snapshot_offset - header->snapshot_output)) {
+        return false;
+    }
+
+    // Built aside, so a bad cache leaves the interpreter as it was
+    Program program = {0};
+    program.code = (Op *)(data + sizeof(CacheHeader));
+    program.lines = (int *)(data + lines_offset);
+    program.length = header->length;
+    program.capacity = header->length;
+    program.mapping = data;
+    program.mapping_size = size;
+
+    LabelTable labels;
+    lt_init(&labels);
+
+    if (!cache_read_constants(&program, data, header->constants_offset, header->labels_offset,
+                              header->constant_count) ||
+        !cache_read_labels(&labels, data, header->labels_offset, labels_end, header->label_count,
+                           header->length) ||
+        !cache_check_code(&program, header->label_count, header->source_length)) {
+        for (int i = 0; i < program.constant_count; i++) {
+            value_free_constant(program.constants[i]);
+        }
+        free(program.constants);
+        lt_free(&labels);
+        return false;
+    }
+
+    Program *old = &interpreter->program;
+    cache_release(old);
+    free(old->code);
+    free(old->lines);
+    for (int i = 0; i < old->constant_count; i++) {
+        value_free_constant(old->constants[i]);
+    }
+    free(old->constants);
+    *old = program;
+
+    lt_free(&interpreter->labels);
+    interpreter->labels = labels;
+    jit_free(interpreter->jit_code);
+    interpreter->jit_code = NULL;
+    // Unchecked opcodes in the file are not taken on trust
+    verify_program(interpreter);
+
+    *snapshotted = snapshot != NULL && header->snapshot_offset != 0;
+    if (*snapshotted) cache_read_snapshot(snapshot, data, header);
+    return true;
+}
+
+// WRITING
+
+static uint64_t constant_size(const Value v) {
+    return 8 + 4 * (value_is_small(v) ? 2 : (uint64_t)value_big(v)->length);
+}
+
+static uint8_t* put_constant(uint8_t *out, const Value v) {
+    int32_t record[2];
+    uint32_t small[2];
+    const uint32_t *limbs = small;
+
+    if (value_is_small(v)) {
+        const intptr_t n = value_small(v);
+        const uint64_t magnitude = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+        small[0] = (uint32_t)magnitude;
+        small[1] = (uint32_t)(magnitude >> 32);
+        record[0] = n < 0 ? -1 : 1;
+        record[1] = 2;
+    } else {
+        record[0] = value_big(v)->sign;
+        record[1] = value_big(v)->length;
+        limbs = value_big(v)->limbs;
+    }
+
+    memcpy(out, record, sizeof(record));
+    memcpy(out + 8, limbs, 4 * (size_t)record[1]);
+    return out + 8 + 4 * (size_t)record[1];
+}
+
+static int cache_write(const Interpreter *interpreter, const char *path, const Snapshot *snapshot) {
+    const Program *program = &interpreter->program;
+    const LabelTable *labels = &interpreter->labels;
+
+    CacheHeader header = {0};
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.layout = cache_layout();
+    header.source_length = (uint64_t)interpreter->parser.length;
+    header.source_hash = interpreter_source_hash(interpreter);
+    header.flags = (interpreter->fuse ? CACHE_FUSED : 0) | (uint32_t)interpreter->optimize << CACHE_LEVEL_SHIFT;
+    header.length = program->length;
+    header.constant_count = program->constant_count;
+    header.label_count = labels->count;
+
+    const uint64_t length = (uint64_t)program->length;
+    header.constants_offset = sizeof(CacheHeader) + length * (sizeof(Op) + sizeof(int));
+    header.labels_offset = header.constants_offset;
+    for (int i = 0; i < program->constant_count; i++) {
+        header.labels_offset += constant_size(program->constants[i]);
+    }
+    header.size = header.labels_offset;
+    for (int i = 0; i < labels->count; i++) {
+        header.size += 8 + ALIGN4((uint64_t)labels->entries[i].length);
+    }
+    if (snapshot != NULL) {
+        header.snapshot_offset = header.size;
+        header.snapshot_output = snapshot->output_size;
+        header.snapshot_state = snapshot->state_size;
+        header.snapshot_finished = snapshot->finished;
+        header.size += snapshot->output_size + snapshot->state_size;
+    }
+
+    uint8_t *data = calloc(1, header.size);
+    if (data == NULL) return -1;
+
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(CacheHeader), program->code, length * sizeof(Op));
+    memcpy(data + sizeof(CacheHeader) + length * sizeof(Op), program->lines, length * sizeof(int));
+
+    uint8_t *out = data + header.constants_offset;
+    for (int i = 0; i < program->constant_count; i++) {
+        out = put_constant(out, program->constants[i]);
+    }
+    for (int i = 0; i < labels->count; i++) {
+        const int32_t record[2] = {labels->entries[i].position, labels->entries[i].length};
+        memcpy(out, record, sizeof(record));
+        memcpy(out + 8, labels->entries[i].name, (size_t)record[1]);
+        out += 8 + ALIGN4((uint64_t)record[1]);
+    }
+    if (snapshot != NULL && snapshot->output_size > 0) {
+        memcpy(out, snapshot->output, snapshot->output_size);
+        out += snapshot->output_size;
+    }
+    if (snapshot != NULL && snapshot->state_size > 0) {
+        memcpy(out, snapshot->state, snapshot->state_size);
+    }
+
+    // Beside it and renamed, so a concurrent start never maps half a file
+    char *temporary = malloc(strlen(path) + 5);
+    if (temporary == NULL) {
+        free(data);
+        return -1;
+    }
+    sprintf(temporary, "%s.tmp", path);
+
+    FILE *file = fopen(temporary, "wb");
+    bool written = file != NULL && fwrite(data, 1, header.size, file) == header.size;
+    if (file != NULL && fclose(file) != 0) written = false;
+#ifdef _WIN32
+    if (written) remove(path);
+#endif
+    if (written && rename(temporary, path) != 0) written = false;
+    if (!written) remove(temporary);
+
+    free(temporary);
+    free(data);
+    return written ? 0 : -1;
+}
+
+int cache_read_from_file(Interpreter *interpreter, const char *source, const char *cache_path,
+                         Snapshot *snapshot) {
+    if (interpreter_read_source(interpreter, source) != 0) {
+        return -1;
+    }
+
+    size_t size;
+    bool cached = false;
+    bool snapshotted = false;
+    uint8_t *data = map_file(cache_path, &size);
+    if (data != NULL) {
+        cached = cache_use(interpreter, data, size, snapshot, &snapshotted);
+        if (!cached) unmap_file(data, size);
+    }
+
+    if (!cached && interpreter_decode(interpreter) != 0) {
+        return -1;
+    }
+    if (cached && (snapshot == NULL || snapshotted)) {
+        return 0;
+    }
+
+    // Rewritten with the snapshot if the cache had none
+    if (snapshot != NULL) snapshot_take(interpreter, snapshot);
+    if (interpreter->parser.warnings > 0) return 0;
+    if (cache_write(interpreter, cache_path, snapshot) != 0) {
+        fprintf(stderr, "Warning: Cannot write cache %s\n", cache_path);
+    }
+    return 0;
+}
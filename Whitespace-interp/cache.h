@@ -0,0 +1,27 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "interpreter.h"
+#include "preeval.h"
+
+// Default cache of a source file, allocated
+char* cache_path_for(const char *source);
+
+// Load a program file through a compiled-program cache at cache_path. A
+// cache made from the same source (by content hash) is mapped and used as
+// the decoded program; otherwise the source is decoded and the cache
+// written for next time, unless the decoder warned about it. With
+// snapshot, the program is also pre-evaluated into it (--pre-eval), or the
+// snapshot taken by an earlier run read from the cache. 0 on success, -1
+// if the program does not load
+int cache_read_from_file(Interpreter *interpreter, const char *source, const char *cache_path,
+                         Snapshot *snapshot);
+
+// Drop the mapping code and lines point into, if any
+void cache_release(Program *program);
+
+#endif //CACHE_H
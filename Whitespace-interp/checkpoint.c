@@ -0,0 +1,449 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Checkpoint format. Integers are LEB128 varints unless noted, signed
+// ones zigzag encoded:
+//   "WSCK", version byte, flags byte (CHECKPOINT_FUSED, -O level above it)
+//   source length, source hash (FNV-1a, 8 bytes little endian)
+//   program length, pc
+//   labels: count, then the length and '0'/'1' name of each
+//   value stack: count, values from the bottom
+//   call stack: count, return addresses from the bottom
+//   heap: count, then for each non-zero cell its address as a signed
+//   difference to the previous one, and its value
+//   input read ahead: count, bytes
+// A value is a kind byte, then the number for KIND_SMALL, or the limb
+// count and the limbs (4 bytes little endian each) for a bignum.
+// Labels, pc and return addresses refer to the decoded program, so a
+// checkpoint only fits the same source decoded with the same fusion and
+// -O level.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "optimize.h"
+#include "verify.h"
+
+#define CHECKPOINT_MAGIC "WSCK"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_FUSED 1
+#define CHECKPOINT_LEVEL_SHIFT 1
+
+enum {
+    KIND_SMALL,
+    KIND_POSITIVE,
+    KIND_NEGATIVE
+};
+
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    bool failed;        // Out of memory, the rest is dropped
+} Writer;
+
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    size_t position;
+    bool failed;        // Ran past the end or read nonsense
+} Reader;
+
+// Heap cells being counted or written
+typedef struct {
+    Writer *writer;
+    size_t count;
+    uint64_t previous;
+} CellWriter;
+
+// WRITING
+
+static void put_bytes(Writer *w, const void *data, const size_t size) {
+    if (w->failed || size == 0) return;
+
+    if (w->length + size > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 4096;
+        while (capacity < w->length + size) capacity *= 2;
+
+        uint8_t *grown = realloc(w->data, capacity);
+        if (grown == NULL) {
+            w->failed = true;
+            return;
+        }
+        w->data = grown;
+        w->capacity = capacity;
+    }
+
+    memcpy(w->data + w->length, data, size);
+    w->length += size;
+}
+
+static void put_byte(Writer *w, const uint8_t byte) {
+    put_bytes(w, &byte, 1);
+}
+
+static void put_unsigned(Writer *w, uint64_t n) {
+    while (n >= 0x80) {
+        put_byte(w, (uint8_t)(n | 0x80));
+        n >>= 7;
+    }
+    put_byte(w, (uint8_t)n);
+}
+
+static void put_signed(Writer *w, const int64_t n) {
+    put_unsigned(w, ((uint64_t)n << 1) ^ (n < 0 ? UINT64_MAX : 0));
+}
+
+static void put_value(Writer *w, const Value v) {
+    if (value_is_small(v)) {
+        put_byte(w, KIND_SMALL);
+        put_signed(w, value_small(v));
+        return;
+    }
+
+    const BigInt *big = value_big(v);
+    put_byte(w, big->sign < 0 ? KIND_NEGATIVE : KIND_POSITIVE);
+    put_unsigned(w, (uint64_t)big->length);
+    for (int i = 0; i < big->length; i++) {
+        const uint32_t limb = big->limbs[i];
+        const uint8_t bytes[4] = {(uint8_t)limb, (uint8_t)(limb >> 8), (uint8_t)(limb >> 16), (uint8_t)(limb >> 24)};
+        put_bytes(w, bytes, 4);
+    }
+}
+
+static void count_cell(void *user, const intptr_t address, const Value value) {
+    ((CellWriter*)user)->count++;
+}
+
+static void put_cell(void *user, const intptr_t address, const Value value) {
+    CellWriter *cells = user;
+    put_signed(cells->writer, (int64_t)((uint64_t)address - cells->previous));
+    put_value(cells->writer, value);
+    cells->previous = (uint64_t)address;
+}
+
+static void put_stacks(Writer *w, const Interpreter *interpreter) {
+    const Stack *stack = interpreter->stack;
+    put_unsigned(w, (uint64_t)(stack->top + 1));
+    for (int i = 0; i <= stack->top; i++) {
+        put_value(w, stack->data[i]);
+    }
+
+    const Stack *calls = interpreter->call_stack;
+    put_unsigned(w, (uint64_t)(calls->top + 1));
+    for (int i = 0; i <= calls->top; i++) {
+        put_unsigned(w, (uint64_t)calls->data[i]);
+    }
+}
+
+uint8_t* checkpoint_encode(const Interpreter *interpreter, size_t *size) {
+    const ParserState *parser = &interpreter->parser;
+    const Program *program = &interpreter->program;
+    const LabelTable *labels = &interpreter->labels;
+    const Input *input = &interpreter->input;
+
+    Writer w = {0};
+    put_bytes(&w, CHECKPOINT_MAGIC, 4);
+    put_byte(&w, CHECKPOINT_VERSION);
+    put_byte(&w, (uint8_t)((interpreter->fuse ? CHECKPOINT_FUSED : 0) | interpreter->optimize << CHECKPOINT_LEVEL_SHIFT));
+
+    const uint64_t hash = interpreter_source_hash(interpreter);
+    put_unsigned(&w, (uint64_t)parser->length);
+    for (int i = 0; i < 8; i++) {
+        put_byte(&w, (uint8_t)(hash >> (8 * i)));
+    }
+
+    put_unsigned(&w, (uint64_t)program->length);
+    put_unsigned(&w, (uint64_t)interpreter->pc);
+
+    put_unsigned(&w, (uint64_t)labels->count);
+    for (int i = 0; i < labels->count; i++) {
+        put_unsigned(&w, (uint64_t)labels->entries[i].length);
+        put_bytes(&w, labels->entries[i].name, (size_t)labels->entries[i].length);
+    }
+
+    put_stacks(&w, interpreter);
+
+    CellWriter cells = {&w, 0, 0};
+    heap_each(&interpreter->heap, count_cell, &cells);
+    put_unsigned(&w, cells.count);
+    heap_each(&interpreter->heap, put_cell, &cells);
+
+    const size_t pending = input->length - input->position;
+    put_unsigned(&w, pending);
+    put_bytes(&w, input->data + input->position, pending);
+
+    if (w.failed) {
+        free(w.data);
+        return NULL;
+    }
+
+    *size = w.length;
+    return w.data;
+}
+
+int checkpoint_save(Interpreter *interpreter, const char *path) {
+    if (interpreter->parser.source == NULL) {
+        fprintf(stderr, "Checkpoint %s: no program source to identify it\n", path);
+        return -1;
+    }
+
+    // Everything before the checkpoint has been written
+    output_flush(&interpreter->output);
+
+    size_t size;
+    uint8_t *data = checkpoint_encode(interpreter, &size);
+    if (data == NULL) {
+        fprintf(stderr, "Checkpoint %s: out of memory\n", path);
+        return -1;
+    }
+
+    // Write beside it and rename, so a crash never leaves half a checkpoint
+    char *temporary = malloc(strlen(path) + 5);
+    if (temporary == NULL) {
+        fprintf(stderr, "Checkpoint %s: out of memory\n", path);
+        free(data);
+        return -1;
+    }
+    sprintf(temporary, "%s.tmp", path);
+
+    FILE *file = fopen(temporary, "wb");
+    bool written = file != NULL && fwrite(data, 1, size, file) == size;
+    if (file != NULL && fclose(file) != 0) written = false;
+#ifdef _WIN32
+    // rename does not replace existing files there
+    if (written) remove(path);
+#endif
+    if (written && rename(temporary, path) != 0) written = false;
+
+    if (!written) {
+        perror("Error writing checkpoint");
+        remove(temporary);
+    }
+
+    free(temporary);
+    free(data);
+    return written ? 0 : -1;
+}
+
+// READING
+
+static uint8_t get_byte(Reader *r) {
+    if (r->position >= r->length) {
+        r->failed = true;
+        return 0;
+    }
+    return r->data[r->position++];
+}
+
+static const uint8_t* get_bytes(Reader *r, const size_t size) {
+    if (size > r->length - r->position) {
+        r->failed = true;
+        return NULL;
+    }
+
+    const uint8_t *bytes = r->data + r->position;
+    r->position += size;
+    return bytes;
+}
+
+static uint64_t get_unsigned(Reader *r) {
+    uint64_t n = 0;
+    for (int shift = 0; shift < 64 && !r->failed; shift += 7) {
+        const uint8_t byte = get_byte(r);
+        n |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return n;
+    }
+
+    r->failed = true;
+    return 0;
+}
+
+static int64_t get_signed(Reader *r) {
+    const uint64_t n = get_unsigned(r);
+    return (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+}
+
+// A count of at most limit
+static size_t get_count(Reader *r, const uint64_t limit) {
+    const uint64_t n = get_unsigned(r);
+    if (n > limit) {
+        r->failed = true;
+        return 0;
+    }
+    return (size_t)n;
+}
+
+static Value get_value(Reader *r, BigPool *pool) {
+    const uint8_t kind = get_byte(r);
+
+    if (kind == KIND_SMALL) {
+        // Small on a 64 bit build may not be on a 32 bit one
+        return value_from_int64(pool, get_signed(r));
+    }
+
+    if (kind != KIND_POSITIVE && kind != KIND_NEGATIVE) {
+        r->failed = true;
+        return 0;
+    }
+
+    const size_t length = get_count(r, (r->length - r->position) / 4);
+    const uint8_t *bytes = get_bytes(r, length * 4);
+    if (r->failed || length == 0) {
+        r->failed = true;
+        return 0;
+    }
+
+    uint32_t *limbs = malloc(length * sizeof(uint32_t));
+    if (limbs == NULL) {
+        r->failed = true;
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        limbs[i] = (uint32_t)bytes[4 * i] | (uint32_t)bytes[4 * i + 1] << 8 |
+                   (uint32_t)bytes[4 * i + 2] << 16 | (uint32_t)bytes[4 * i + 3] << 24;
+    }
+
+    const Value v = value_from_limbs(pool, kind == KIND_NEGATIVE ? -1 : 1, limbs, (int)length);
+    free(limbs);
+    return v;
+}
+
+// Whether the checkpoint belongs to the loaded program; NULL if it does,
+// otherwise why not. Sets the pc to resume at
+static const char* read_header(Reader *r, const Interpreter *interpreter, int *pc) {
+    const ParserState *parser = &interpreter->parser;
+    const Program *program = &interpreter->program;
+    const LabelTable *labels = &interpreter->labels;
+
+    const uint8_t *magic = get_bytes(r, 4);
+    if (magic == NULL || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0) return "not a checkpoint";
+    if (get_byte(r) != CHECKPOINT_VERSION) return "written by another version";
+
+    static const char *const levels[OPTIMIZE_MAX + 1] = {"taken with -O0", "taken with -O1", "taken with -O2"};
+    const uint8_t flags = get_byte(r);
+    const bool fused = (flags & CHECKPOINT_FUSED) != 0;
+    if (fused != interpreter->fuse) {
+        return fused ? "taken with fusion, drop --no-fuse" : "taken with --no-fuse";
+    }
+    const int level = flags >> CHECKPOINT_LEVEL_SHIFT;
+    if (level != interpreter->optimize) {
+        return level <= OPTIMIZE_MAX ? levels[level] : "taken at another optimization level";
+    }
+
+    uint64_t hash = 0;
+    const uint64_t length = get_unsigned(r);
+    for (int i = 0; i < 8; i++) {
+        hash |= (uint64_t)get_byte(r) << (8 * i);
+    }
+    if (parser->source == NULL || length != (uint64_t)parser->length ||
+        hash != interpreter_source_hash(interpreter)) {
+        return "taken from another program";
+    }
+
+    if (get_unsigned(r) != (uint64_t)program->length) return "taken from another program";
+
+    const uint64_t resume = get_unsigned(r);
+    if (resume >= (uint64_t)program->length) return "corrupt";
+    *pc = (int)resume;
+
+    if (get_unsigned(r) != (uint64_t)labels->count) return "taken from another program";
+    for (int i = 0; i < labels->count && !r->failed; i++) {
+        const size_t name_length = get_count(r, r->length);
+        const uint8_t *name = get_bytes(r, name_length);
+        if (name == NULL) break;
+
+        if (name_length != (size_t)labels->entries[i].length ||
+            memcmp(name, labels->entries[i].name, name_length) != 0) {
+            return "taken from another program";
+        }
+    }
+
+    return r->failed ? "truncated" : NULL;
+}
+
+// Stacks, heap and input, into a freshly reset interpreter
+static const char* read_state(Reader *r, Interpreter *interpreter) {
+    Stack *stack = interpreter->stack;
+    const size_t count = get_count(r, (uint64_t)stack->maximum);
+    if (!st_reserve(stack, (int)count)) return "out of memory";
+    for (size_t i = 0; i < count && !r->failed; i++) {
+        stack->data[++stack->top] = get_value(r, &interpreter->bigs);
+    }
+
+    Stack *calls = interpreter->call_stack;
+    const size_t depth = get_count(r, (uint64_t)calls->maximum);
+    if (!st_reserve(calls, (int)depth)) return "out of memory";
+    for (size_t i = 0; i < depth && !r->failed; i++) {
+        calls->data[++calls->top] = (Value)get_count(r, (uint64_t)interpreter->program.length - 1);
+    }
+
+    const size_t cells = get_count(r, r->length);
+    uint64_t address = 0;
+    for (size_t i = 0; i < cells && !r->failed; i++) {
+        address += (uint64_t)get_signed(r);
+        const Value value = get_value(r, &interpreter->bigs);
+        if (!r->failed && !heap_store(&interpreter->heap, (intptr_t)address, value)) {
+            return "out of memory";
+        }
+    }
+
+    Input *input = &interpreter->input;
+    const size_t pending = get_count(r, INPUT_SIZE);
+    const uint8_t *bytes = get_bytes(r, pending);
+    if (r->failed) return "truncated";
+
+    if (pending > 0) {
+        input->data = malloc(INPUT_SIZE);
+        if (input->data == NULL) return "out of memory";
+        memcpy(input->data, bytes, pending);
+        input->length = pending;
+    }
+
+    return r->position == r->length ? NULL : "corrupt";
+}
+
+const char* checkpoint_decode(Interpreter *interpreter, const uint8_t *data, const size_t size) {
+    Reader r = {data, size, 0, false};
+    int pc = 0;
+    const char *problem = read_header(&r, interpreter, &pc);
+    if (problem == NULL) {
+        interpreter_reset(interpreter);
+        problem = read_state(&r, interpreter);
+        interpreter->pc = pc;
+        // Checks proven for a run from the start need not hold from here
+        if (problem == NULL) verify_program(interpreter);
+    }
+
+    if (problem != NULL) {
+        interpreter_reset(interpreter);
+        interpreter->running = false;
+    }
+    return problem;
+}
+
+int checkpoint_restore(Interpreter *interpreter, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror("Error opening checkpoint");
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = size > 0 ? malloc((size_t)size) : NULL;
+    const bool read = data != NULL && fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+
+    const char *problem = checkpoint_decode(interpreter, data, read ? (size_t)size : 0);
+    free(data);
+    if (problem != NULL) {
+        fprintf(stderr, "Checkpoint %s: %s\n", path, problem);
+        return -1;
+    }
+    return 0;
+}
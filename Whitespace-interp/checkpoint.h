@@ -0,0 +1,31 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "interpreter.h"
+
+// Write the state of a running program to path: stacks, heap, pc, labels
+// and input read ahead but not consumed, tagged with a hash of the source.
+// Pending output is flushed first. 0 on success, -1 with a message on
+// stderr otherwise
+int checkpoint_save(Interpreter *interpreter, const char *path);
+
+// Continue from a checkpoint of the program that is loaded, which must be
+// decoded from the same source with the same fusion setting. Leaves the
+// interpreter ready for interpreter_continue. 0 on success, -1 with a
+// message on stderr otherwise
+int checkpoint_restore(Interpreter *interpreter, const char *path);
+
+// The bytes checkpoint_save writes, in memory and without flushing output.
+// Allocated, NULL if out of memory
+uint8_t* checkpoint_encode(const Interpreter *interpreter, size_t *size);
+
+// checkpoint_restore from the bytes of a checkpoint. NULL on success,
+// otherwise what is wrong with it; the interpreter is then reset and
+// stopped
+const char* checkpoint_decode(Interpreter *interpreter, const uint8_t *data, size_t size);
+
+#endif //CHECKPOINT_H
@@ -5,6 +5,40 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdint.h>
+
 // #define DEBUG
 
+// Run loop, normally chosen with the WS_ENGINE CMake option:
+// WS_ENGINE_THREADED - computed goto (t_interpreter.c)
+// WS_ENGINE_SWITCH - same loop built as a switch
+// WS_ENGINE_CALL - handler table (m_interpreter.c)
+#if !defined(WS_ENGINE_THREADED) && !defined(WS_ENGINE_SWITCH) && !defined(WS_ENGINE_CALL)
+    #define WS_ENGINE_THREADED
+#endif
+
+// Labels-as-values are a GNU extension
+#if defined(WS_ENGINE_THREADED) && !defined(__GNUC__)
+    #undef WS_ENGINE_THREADED
+    #define WS_ENGINE_SWITCH
+#endif
+
+// Keep the top of the value stack in a local of the threaded loop
+// (WS_TOS_CACHE CMake option)
+#ifndef WS_TOS_CACHE
+    #define WS_TOS_CACHE 1
+#endif
+
+// Reserve the whole of each stack up front with a guard page past the end,
+// so pushes need no bounds check and overflow is caught as a fault
+// (WS_STACK_GUARD CMake option, see guard.c). Needs mmap, SIGSEGV and a
+// 64-bit address space; otherwise stacks grow by realloc behind checks
+#ifndef WS_STACK_GUARD
+    #if !defined(_WIN32) && UINTPTR_MAX > 0xFFFFFFFFu
+        #define WS_STACK_GUARD 1
+    #else
+        #define WS_STACK_GUARD 0
+    #endif
+#endif
+
 #endif //CONFIG_H
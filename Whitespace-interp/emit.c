@@ -0,0 +1,248 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Ahead-of-time compilation: a decoded program becomes a C translation unit
+// built on aot.h. Every slot gets a label L<index> and one macro, so jumps
+// and calls are plain gotos and the C compiler sees the whole program.
+// Returns go through a table of slot labels, indexed like the call stack
+// of the interpreters. emit_listing writes the same program for people
+// (--listing).
+
+#include <stdlib.h>
+#include "emit.h"
+#include "aot.h"
+#include "instruction.h"
+#include "fusion.h"
+#include "verify.h"
+
+static void emit_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static int emit_constants(FILE *out, const Program *program) {
+    fprintf(out, "static const char *const aot_constants[] = {\n");
+    for (int i = 0; i < program->constant_count; i++) {
+        const Value v = program->constants[i];
+        char *text = malloc(value_format_size(v) + 1);
+        if (text == NULL) return -1;
+
+        text[value_format(v, text)] = '\0';
+        fprintf(out, "    \"%s\",\n", text);
+        free(text);
+    }
+    // Keep the array non-empty
+    fprintf(out, "    NULL\n};\n\n");
+    return 0;
+}
+
+static void emit_labels(FILE *out, const LabelTable *labels) {
+    fprintf(out, "static const char *const aot_labels[] = {\n");
+    for (int i = 0; i < labels->count; i++) {
+        fprintf(out, "    \"%s\",\n", labels->entries[i].name);
+    }
+    fprintf(out, "    NULL\n};\n\n");
+}
+
+static void emit_slot(FILE *out, const Op *op, const int i) {
+    const int n = op->operand;
+
+    const int proven = verify_depth(op);
+    if (proven > 0) fprintf(out, "AOT_PROVEN(%d); ", proven);
+
+    switch (fusion_first(op->opcode)) {
+        case OP_PUSH:       fprintf(out, "AOT_PUSH(%d, %d);", i, n); break;
+        case OP_PUSH_CONST: fprintf(out, "AOT_PUSH_CONST(%d, %d);", i, n); break;
+        case OP_DUP:        fprintf(out, "AOT_DUP(%d);", i); break;
+        case OP_SWAP:       fprintf(out, "AOT_SWAP(%d);", i); break;
+        case OP_DISCARD:    fprintf(out, "AOT_DISCARD(%d);", i); break;
+        case OP_ADD:        fprintf(out, "AOT_ADD(%d);", i); break;
+        case OP_SUB:        fprintf(out, "AOT_SUB(%d);", i); break;
+        case OP_MUL:        fprintf(out, "AOT_MUL(%d);", i); break;
+        case OP_DIV:        fprintf(out, "AOT_DIV(%d);", i); break;
+        case OP_MOD:        fprintf(out, "AOT_MOD(%d);", i); break;
+        case OP_STORE:      fprintf(out, "AOT_STORE(%d);", i); break;
+        case OP_RETRIEVE:   fprintf(out, "AOT_RETRIEVE(%d);", i); break;
+        case OP_RET:        fprintf(out, "AOT_RET(%d);", i); break;
+        case OP_END:        fprintf(out, "AOT_END(%d);", i); break;
+
+        // Negative counts and undefined labels end in the handler's error
+        case OP_COPY:
+            if (n < 0 || n > AOT_MAX_DEPTH) fprintf(out, "AOT_SLOW(%d);", i);
+            else fprintf(out, "AOT_COPY(%d, %d);", i, n);
+            break;
+        case OP_SLIDE:
+            if (n < 0 || n > AOT_MAX_DEPTH) fprintf(out, "AOT_SLOW(%d);", i);
+            else fprintf(out, "AOT_SLIDE(%d, %d);", i, n);
+            break;
+        case OP_CALL:
+            if (n < 0) fprintf(out, "AOT_SLOW(%d);", i);
+            else fprintf(out, "AOT_CALL(%d, L%d);", i, n);
+            break;
+        case OP_JUMP:
+            if (n < 0) fprintf(out, "AOT_SLOW(%d);", i);
+            else fprintf(out, "AOT_JUMP(L%d);", n);
+            break;
+        case OP_JZ:
+            if (n < 0) fprintf(out, "AOT_SLOW(%d);", i);
+            else fprintf(out, "AOT_JZ(%d, L%d);", i, n);
+            break;
+        case OP_JN:
+            if (n < 0) fprintf(out, "AOT_SLOW(%d);", i);
+            else fprintf(out, "AOT_JN(%d, L%d);", i, n);
+            break;
+
+        // I/O
+        default:
+            fprintf(out, "AOT_SLOW(%d);", i);
+            break;
+    }
+}
+
+// Write program as C to out. labels are the ones it was decoded with,
+// name is the source file, for the comments
+int emit_c(FILE *out, const Program *program, const LabelTable *labels, const char *name) {
+    const int length = program->length;
+
+    fprintf(out, "// Compiled from %s by Whitespace_interp --emit-c, do not edit\n\n", name);
+    fprintf(out, "#include \"aot.h\"\n\n");
+
+    fprintf(out, "static const Op aot_code[%d] = {\n", length);
+    for (int i = 0; i < length; i++) {
+        fprintf(out, "    {%d, %d},\n", program->code[i].opcode, program->code[i].operand);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const int aot_lines[%d] = {\n", length);
+    for (int i = 0; i < length; i++) {
+        fprintf(out, "%s%d,%s", i % 16 == 0 ? "    " : " ", program->lines[i], i % 16 == 15 || i == length - 1 ? "\n" : "");
+    }
+    fprintf(out, "};\n\n");
+
+    if (emit_constants(out, program) != 0) return -1;
+    emit_labels(out, labels);
+
+    fprintf(out, "static void aot_run(Interpreter *interpreter) {\n");
+    fprintf(out, "#ifdef AOT_COMPUTED_GOTO\n");
+    fprintf(out, "    static void *const aot_slots[%d] = {\n", length);
+    for (int i = 0; i < length; i++) {
+        fprintf(out, "%s&&L%d,%s", i % 8 == 0 ? "        " : " ", i, i % 8 == 7 || i == length - 1 ? "\n" : "");
+    }
+    fprintf(out, "    };\n");
+    fprintf(out, "#else\n");
+    fprintf(out, "    int aot_target;\n");
+    fprintf(out, "#endif\n");
+    fprintf(out, "    AOT_ENTER();\n");
+    fprintf(out, "    AOT_DISPATCH(interpreter->pc);\n\n");
+
+    fprintf(out, "#ifndef AOT_COMPUTED_GOTO\n");
+    fprintf(out, "aot_dispatch:\n");
+    fprintf(out, "    switch (aot_target) {\n");
+    for (int i = 0; i < length; i++) {
+        fprintf(out, "        case %d: goto L%d;\n", i, i);
+    }
+    fprintf(out, "        default: goto aot_halt;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "#endif\n\n");
+
+    for (int i = 0; i < length; i++) {
+        fprintf(out, "L%d: ", i);
+        emit_slot(out, &program->code[i], i);
+        fprintf(out, " // %s, line %d\n", opcode_names[program->code[i].opcode], program->lines[i]);
+    }
+
+    fprintf(out, "\naot_halt:\n");
+    fprintf(out, "    AOT_LEAVE();\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "int main(void) {\n");
+    fprintf(out, "    static const AotProgram program = {\n");
+    fprintf(out, "        ");
+    emit_string(out, name);
+    fprintf(out, ", aot_code, aot_lines, %d, aot_constants, %d, aot_labels, %d, aot_run\n",
+            length, program->constant_count, labels->count);
+    fprintf(out, "    };\n");
+    fprintf(out, "    return aot_main(&program);\n");
+    fprintf(out, "}\n");
+
+    return ferror(out) ? -1 : 0;
+}
+
+static void emit_operand(FILE *out, const Program *program, const LabelTable *labels, const Op *op) {
+    const int n = op->operand;
+
+    switch (fusion_first(op->opcode)) {
+        case OP_PUSH:
+        case OP_COPY:
+        case OP_SLIDE:
+            fprintf(out, " %d", n);
+            break;
+
+        case OP_PUSH_CONST:
+            fputc(' ', out);
+            value_fprint(out, program->constants[n]);
+            break;
+
+        case OP_CALL:
+        case OP_JUMP:
+        case OP_JZ:
+        case OP_JN:
+            if (n >= 0) fprintf(out, " %d", n);
+            else fprintf(out, " undefined label %s", labels->entries[-n - 1].name);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Write the program as loaded to out, one slot per line under the labels
+// that mark it. Fused slots show the whole sequence, the slots it covers
+// follow as they were
+int emit_listing(FILE *out, const Interpreter *interpreter, const char *name) {
+    const Program *program = &interpreter->program;
+    const LabelTable *labels = &interpreter->labels;
+    const int length = program->length;
+
+    // Labels of each slot as lists through next
+    int *first = malloc(length * sizeof(int));
+    int *next = malloc((labels->count + 1) * sizeof(int));
+    if (first == NULL || next == NULL) {
+        free(first);
+        free(next);
+        return -1;
+    }
+    for (int i = 0; i < length; i++) {
+        first[i] = -1;
+    }
+    for (int i = labels->count - 1; i >= 0; i--) {
+        const int position = labels->entries[i].position;
+        if (position < 0 || position >= length) continue;
+        next[i] = first[position];
+        first[position] = i;
+    }
+
+    fprintf(out, "; %s: %d slots, -O%d%s\n", name, length, interpreter->optimize,
+            interpreter->fuse ? "" : ", --no-fuse");
+    fprintf(out, ";  slot   line  instruction\n");
+    for (int i = 0; i < length; i++) {
+        for (int l = first[i]; l >= 0; l = next[l]) {
+            fprintf(out, "label %s:\n", labels->entries[l].length ? labels->entries[l].name : "(empty)");
+        }
+
+        const Op *op = &program->code[i];
+        fprintf(out, "%7d %6d  %s", i, program->lines[i], opcode_names[op->opcode]);
+        emit_operand(out, program, labels, op);
+        if (verify_depth(op) > 0) fprintf(out, "  ; no stack check");
+        fputc('\n', out);
+    }
+
+    free(first);
+    free(next);
+    return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,14 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef EMIT_H
+#define EMIT_H
+
+#include <stdio.h>
+#include "interpreter.h"
+
+int emit_c(FILE *out, const Program *program, const LabelTable *labels, const char *name);
+int emit_listing(FILE *out, const Interpreter *interpreter, const char *name);
+
+#endif //EMIT_H
@@ -0,0 +1,146 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Superinstructions: frequent adjacent sequences get a single fused opcode in
+// the slot of their first instruction. The other slots are left untouched, so
+// a jump into the middle of a sequence runs the original instructions, and an
+// engine without a dedicated handler can just execute the first one.
+
+#include "fusion.h"
+#include "instruction.h"
+#include "verify.h"
+
+#define FUSION_COUNT (sizeof(fusion_table) / sizeof(fusion_table[0]))
+#define REPORT_PAIRS 10
+
+typedef struct {
+    uint8_t fused;
+    uint8_t len;
+    uint8_t ops[4];
+} Fusion;
+
+// Longer sequences first, so they win over their own prefixes
+static const Fusion fusion_table[] = {
+    {OP_PUSH_SUB_DUP_JN,    4, {OP_PUSH,    OP_SUB,     OP_DUP,     OP_JN}},
+    {OP_PUSH_PUSH_STORE,    3, {OP_PUSH,    OP_PUSH,    OP_STORE}},
+    {OP_PUSH_ADD,           2, {OP_PUSH,    OP_ADD}},
+    {OP_PUSH_SUB,           2, {OP_PUSH,    OP_SUB}},
+    {OP_PUSH_MUL,           2, {OP_PUSH,    OP_MUL}},
+    {OP_PUSH_STORE,         2, {OP_PUSH,    OP_STORE}},
+    {OP_PUSH_RETRIEVE,      2, {OP_PUSH,    OP_RETRIEVE}},
+    {OP_PUSH_OUT_CHAR,      2, {OP_PUSH,    OP_OUT_CHAR}},
+    {OP_DUP_JZ,             2, {OP_DUP,     OP_JZ}},
+    {OP_DUP_JN,             2, {OP_DUP,     OP_JN}},
+    {OP_SUB_JZ,             2, {OP_SUB,     OP_JZ}},
+    {OP_SWAP_SUB,           2, {OP_SWAP,    OP_SUB}},
+};
+
+static bool fusion_matches(const Program *program, int i, const Fusion *fusion) {
+    if (i + fusion->len > program->length) return false;
+
+    for (int j = 0; j < fusion->len; j++) {
+        if (program->code[i + j].opcode != fusion->ops[j]) return false;
+    }
+    return true;
+}
+
+// Number of slots an instruction covers, 1 for plain instructions
+int fusion_length(uint8_t opcode) {
+    opcode = verify_checked(opcode);
+    for (size_t k = 0; k < FUSION_COUNT; k++) {
+        if (fusion_table[k].fused == opcode) return fusion_table[k].len;
+    }
+    return 1;
+}
+
+// Opcode of the first instruction a fused one stands for, plain opcodes
+// map to themselves. Unchecked opcodes count as their checked ones
+uint8_t fusion_first(uint8_t opcode) {
+    opcode = verify_checked(opcode);
+    for (size_t k = 0; k < FUSION_COUNT; k++) {
+        if (fusion_table[k].fused == opcode) return fusion_table[k].ops[0];
+    }
+    return opcode;
+}
+
+// Whether a fused opcode at i is still followed by the rest of its
+// sequence, always true for plain opcodes. The rest may have been made
+// unchecked too (see verify.c)
+bool fusion_intact(const Program *program, const int i) {
+    for (size_t k = 0; k < FUSION_COUNT; k++) {
+        const Fusion *fusion = &fusion_table[k];
+        if (fusion->fused != verify_checked(program->code[i].opcode)) continue;
+
+        if (i + fusion->len > program->length) return false;
+        for (int j = 1; j < fusion->len; j++) {
+            if (verify_checked(program->code[i + j].opcode) != fusion->ops[j]) return false;
+        }
+        return true;
+    }
+    return true;
+}
+
+void fuse_program(Program *program) {
+    int i = 0;
+
+    while (i < program->length) {
+        int len = 1;
+
+        for (size_t k = 0; k < FUSION_COUNT; k++) {
+            if (fusion_matches(program, i, &fusion_table[k])) {
+                program->code[i].opcode = fusion_table[k].fused;
+                len = fusion_table[k].len;
+                break;
+            }
+        }
+
+        i += len;
+    }
+}
+
+// Which fusions fired, and the most frequent pairs that are still separate
+void fusion_report(FILE *out, const Program *program) {
+    int fused[OP_COUNT] = {0};
+    int pairs[OP_COUNT][OP_COUNT] = {{0}};
+    int instructions = 0;
+    int dispatches = 0;
+
+    for (int i = 0; i < program->length - 1;) {
+        const uint8_t opcode = verify_checked(program->code[i].opcode);
+        const int len = fusion_length(opcode);
+
+        if (len > 1) {
+            fused[opcode]++;
+        } else if (i + 1 < program->length - 1 && fusion_length(program->code[i + 1].opcode) == 1) {
+            pairs[opcode][verify_checked(program->code[i + 1].opcode)]++;
+        }
+
+        instructions += len;
+        dispatches++;
+        i += len;
+    }
+
+    fprintf(out, "Fusion: %d instructions in %d dispatches\n", instructions, dispatches);
+    for (size_t k = 0; k < FUSION_COUNT; k++) {
+        const uint8_t opcode = fusion_table[k].fused;
+        fprintf(out, "    %-20s %d\n", opcode_names[opcode], fused[opcode]);
+    }
+
+    fprintf(out, "Most frequent unfused pairs:\n");
+    for (int n = 0; n < REPORT_PAIRS; n++) {
+        int best_a = 0, best_b = 0;
+        for (int a = 0; a < OP_COUNT; a++) {
+            for (int b = 0; b < OP_COUNT; b++) {
+                if (pairs[a][b] > pairs[best_a][best_b]) {
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+
+        if (pairs[best_a][best_b] == 0) break;
+        fprintf(out, "    %-9s %-10s %d\n", opcode_names[best_a], opcode_names[best_b], pairs[best_a][best_b]);
+        pairs[best_a][best_b] = 0;
+    }
+}
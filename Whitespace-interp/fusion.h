@@ -0,0 +1,17 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdio.h>
+#include "interpreter.h"
+
+void fuse_program(Program *program);
+int fusion_length(uint8_t opcode);
+uint8_t fusion_first(uint8_t opcode);
+bool fusion_intact(const Program *program, int i);
+void fusion_report(FILE *out, const Program *program);
+
+#endif //FUSION_H
@@ -0,0 +1,219 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Stack guard pages. With WS_STACK_GUARD each stack is a single mapping of
+// its full size, backed by memory only as the kernel sees pages touched,
+// and followed by a page nothing may access. The run loops push without
+// bounds checks; a push past the end faults on that page and the handler
+// jumps back into guard_run, which reports the overflow. The run being
+// guarded is kept per thread, so batch workers each catch their own.
+
+// MAP_ANONYMOUS, MAP_NORESERVE and SA_SIGINFO are not part of strict C modes
+#define _DEFAULT_SOURCE
+
+#include "guard.h"
+#include "config.h"
+#include "instruction.h"
+#include "fusion.h"
+
+#if WS_STACK_GUARD
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef MAP_NORESERVE
+    #define MAP_NORESERVE 0
+#endif
+
+typedef struct {
+    Interpreter *interpreter;
+    sigjmp_buf jump;
+} GuardFrame;
+
+// Value for siglongjmp: which stack overflowed
+#define GUARD_VALUES 1
+#define GUARD_CALLS 2
+
+static _Thread_local GuardFrame *current = NULL;
+static pthread_once_t installed = PTHREAD_ONCE_INIT;
+static size_t page;
+static struct sigaction previous_segv;
+static struct sigaction previous_bus;
+
+// Bytes mapped in front of the guard page for slots values
+static size_t mapped_bytes(const int slots) {
+    return ((size_t)slots * sizeof(Value) + page - 1) & ~(page - 1);
+}
+
+static void install(void);
+
+Value* guard_map(const int slots) {
+    pthread_once(&installed, install);
+
+    const size_t bytes = mapped_bytes(slots);
+    char *mapping = mmap(NULL, bytes + page, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) return NULL;
+
+    if (mprotect(mapping + bytes, page, PROT_NONE) != 0) {
+        munmap(mapping, bytes + page);
+        return NULL;
+    }
+
+    // The last slot ends right at the guard page
+    return (Value *)(mapping + bytes) - slots;
+}
+
+void guard_unmap(Value *base, const int slots) {
+    const size_t bytes = mapped_bytes(slots);
+    munmap((char *)(base + slots) - bytes, bytes + page);
+}
+
+// The guard page follows the last usable slot
+static bool in_guard(const Stack *stack, const char *address) {
+    const char *guard = (const char *)(stack->data + stack->capacity);
+    return address >= guard && address < guard + page;
+}
+
+static void on_fault(const int signal, siginfo_t *info, void *context) {
+    GuardFrame *frame = current;
+    if (frame != NULL) {
+        if (in_guard(frame->interpreter->stack, info->si_addr)) siglongjmp(frame->jump, GUARD_VALUES);
+        if (in_guard(frame->interpreter->call_stack, info->si_addr)) siglongjmp(frame->jump, GUARD_CALLS);
+    }
+
+    // Not a stack overflow: it is for whatever handled it before, and this
+    // handler stays in place for the other guarded runs
+    const struct sigaction *previous = signal == SIGSEGV ? &previous_segv : &previous_bus;
+    if (previous->sa_flags & SA_SIGINFO) {
+        previous->sa_sigaction(signal, info, context);
+        return;
+    }
+    if (previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN) {
+        previous->sa_handler(signal);
+        return;
+    }
+    // Ignoring one sent with kill is fine, a real fault cannot be ignored
+    if (previous->sa_handler == SIG_IGN && info->si_code <= 0) return;
+
+    // The default action ends the process. The signal is blocked until the
+    // handler returns, so it is raised to be delivered then
+    struct sigaction fallback = {0};
+    fallback.sa_handler = SIG_DFL;
+    sigemptyset(&fallback.sa_mask);
+    sigaction(signal, &fallback, NULL);
+    raise(signal);
+}
+
+// Page size and the fault handler, once per process
+static void install(void) {
+    page = (size_t)sysconf(_SC_PAGESIZE);
+
+    struct sigaction action = {0};
+    action.sa_sigaction = on_fault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &previous_segv);
+    // Some systems raise SIGBUS for protected pages
+    sigaction(SIGBUS, &action, &previous_bus);
+}
+
+// Slot that overflowed the stack. The threaded loop and the JIT only keep
+// pc at the start of the straight run they are in, so the run is followed
+// from there with the depth it began with: on the value stack the first
+// instruction to push onto a full stack faulted, on the call stack the
+// call that ends the run. Fused slots are followed as the instructions
+// they stand for, which still sit in the slots after them
+static int faulting_slot(const Interpreter *interpreter, const int fault) {
+    const Program *program = &interpreter->program;
+    const Stack *stack = interpreter->stack;
+    const int start = interpreter->pc;
+    if (interpreter->run_sp == NULL) return start - 1;
+
+    int depth = (int)(interpreter->run_sp - stack->data) + 1;
+    for (int i = start; i < program->length; i++) {
+        const Op *op = &program->code[i];
+        const uint8_t opcode = fusion_first(op->opcode);
+
+        if (fault == GUARD_CALLS) {
+            if (opcode == OP_CALL) return i;
+            continue;
+        }
+
+        switch (opcode) {
+            case OP_PUSH:
+            case OP_PUSH_CONST:
+            case OP_DUP:
+            case OP_COPY:
+                if (depth >= stack->capacity) return i;
+                depth++;
+                break;
+
+            case OP_SLIDE:
+                if (op->operand > 0) depth = depth - op->operand < 1 ? 1 : depth - op->operand;
+                break;
+
+            case OP_STORE:
+                depth -= 2;
+                break;
+
+            case OP_SWAP:
+            case OP_RETRIEVE:
+                break;
+
+            case OP_CALL:
+            case OP_JUMP:
+            case OP_RET:
+            case OP_END:
+                // The run ends here without having overflowed
+                return start - 1;
+
+            default:
+                // Arithmetic, output, input, discard, not taken branches
+                depth--;
+                break;
+        }
+        if (depth < 0) depth = 0;
+    }
+    return start - 1;
+}
+
+// The handler is in place since the stacks were mapped
+void guard_run(Interpreter *interpreter, const GuardRun run, void *context) {
+    GuardFrame frame;
+    frame.interpreter = interpreter;
+    GuardFrame *const outer = current;
+    // Loops that keep pc exact leave it so, the others set it (see faulting_slot)
+    interpreter->run_sp = NULL;
+
+    const int fault = sigsetjmp(frame.jump, 1);
+    if (fault == 0) {
+        current = &frame;
+        run(interpreter, context);
+        current = outer;
+        return;
+    }
+    current = outer;
+
+    // The run loop kept sp in a register; the stack that overflowed is full.
+    // pc goes past the slot that faulted, as a reference handler leaves it
+    interpreter->pc = faulting_slot(interpreter, fault) + 1;
+    interpreter->run_sp = NULL;
+    Stack *stack = fault == GUARD_VALUES ? interpreter->stack : interpreter->call_stack;
+    stack->top = stack->capacity - 1;
+    interpreter_error(interpreter, "%s overflow (max %d) at line %d\n",
+            fault == GUARD_VALUES ? "Stack" : "Call stack", stack->capacity, interpreter_current_line(interpreter));
+}
+
+#else
+
+void guard_run(Interpreter *interpreter, const GuardRun run, void *context) {
+    run(interpreter, context);
+}
+
+#endif
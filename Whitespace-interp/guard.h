@@ -0,0 +1,22 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef GUARD_H
+#define GUARD_H
+
+#include "interpreter.h"
+
+// Address space for slots values with an inaccessible page right after
+// them. NULL if it cannot be reserved
+Value* guard_map(int slots);
+void guard_unmap(Value *base, int slots);
+
+typedef void (*GuardRun)(Interpreter *interpreter, void *context);
+
+// Call run(interpreter, context). A write past either stack of interpreter
+// ends it early: the overflow is reported as a runtime error and the
+// program stopped. Without WS_STACK_GUARD it is a plain call
+void guard_run(Interpreter *interpreter, GuardRun run, void *context);
+
+#endif //GUARD_H
@@ -0,0 +1,202 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// MAP_ANONYMOUS is not part of strict C/POSIX modes
+#define _DEFAULT_SOURCE
+
+#include "heap.h"
+#include <stdlib.h>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+#endif
+
+#define PAGE_BYTES (HEAP_PAGE_SIZE * sizeof(Value))
+
+// Zero-filled page. Anonymous mappings get their physical memory from the
+// kernel on first write, so even a touched page costs only what is used
+static Value* page_new(void) {
+#ifdef _WIN32
+    return calloc(HEAP_PAGE_SIZE, sizeof(Value));
+#else
+    void *page = mmap(NULL, PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return page == MAP_FAILED ? NULL : page;
+#endif
+}
+
+static void page_free(Value *page) {
+#ifdef _WIN32
+    free(page);
+#else
+    munmap(page, PAGE_BYTES);
+#endif
+}
+
+void heap_init(Heap *heap) {
+    for (size_t i = 0; i < HEAP_TABLE_SIZE; i++) {
+        heap->low.pages[i] = NULL;
+    }
+    heap->directory[0] = &heap->low;
+    for (size_t i = 1; i < HEAP_DIRECTORY_SIZE; i++) {
+        heap->directory[i] = NULL;
+    }
+    heap->pages = 0;
+    heap->sparse = NULL;
+    heap->sparse_count = 0;
+    heap->sparse_capacity = 0;
+}
+
+void heap_free(Heap *heap) {
+    for (size_t i = 0; i < HEAP_DIRECTORY_SIZE; i++) {
+        HeapTable *table = heap->directory[i];
+        if (table == NULL) continue;
+
+        for (size_t j = 0; j < HEAP_TABLE_SIZE; j++) {
+            if (table->pages[j] != NULL) page_free(table->pages[j]);
+        }
+        if (table != &heap->low) free(table);
+    }
+
+    free(heap->sparse);
+    heap_init(heap);
+}
+
+// SPARSE CELLS
+
+static size_t sparse_hash(const intptr_t address) {
+    // Fibonacci hashing spreads strided addresses over the table
+    return (size_t)(((uint64_t)address * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static HeapEntry* sparse_lookup(const Heap *heap, const intptr_t address) {
+    if (heap->sparse_capacity == 0) return NULL;
+
+    const size_t mask = heap->sparse_capacity - 1;
+    for (size_t i = sparse_hash(address) & mask;; i = (i + 1) & mask) {
+        HeapEntry *entry = &heap->sparse[i];
+        if (!entry->used || entry->address == address) return entry;
+    }
+}
+
+static bool sparse_grow(Heap *heap) {
+    const size_t capacity = heap->sparse_capacity ? heap->sparse_capacity * 2 : 64;
+    HeapEntry *entries = calloc(capacity, sizeof(HeapEntry));
+    if (entries == NULL) return false;
+
+    HeapEntry *old = heap->sparse;
+    const size_t old_capacity = heap->sparse_capacity;
+    heap->sparse = entries;
+    heap->sparse_capacity = capacity;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].used) *sparse_lookup(heap, old[i].address) = old[i];
+    }
+
+    free(old);
+    return true;
+}
+
+static bool sparse_store(Heap *heap, const intptr_t address, const Value value) {
+    // Keep the load factor under 3/4
+    if ((heap->sparse_count + 1) * 4 > heap->sparse_capacity * 3 && !sparse_grow(heap)) {
+        return false;
+    }
+
+    HeapEntry *entry = sparse_lookup(heap, address);
+    if (!entry->used) {
+        entry->used = true;
+        entry->address = address;
+        heap->sparse_count++;
+    }
+    entry->value = value;
+    return true;
+}
+
+// ACCESS
+
+// Cells never stored to read as zero
+Value heap_load(const Heap *heap, const intptr_t address) {
+    if ((uintptr_t)address < HEAP_DENSE_LIMIT) {
+        const Value *cell = heap_find(heap, (uintptr_t)address);
+        return cell ? *cell : value_from_small(0);
+    }
+
+    const HeapEntry *entry = sparse_lookup(heap, address);
+    return entry && entry->used ? entry->value : value_from_small(0);
+}
+
+// Returns false when the page or entry could not be allocated
+bool heap_store(Heap *heap, const intptr_t address, const Value value) {
+    if ((uintptr_t)address >= HEAP_DENSE_LIMIT) {
+        return sparse_store(heap, address, value);
+    }
+
+    HeapTable **table = &heap->directory[(uintptr_t)address >> (HEAP_PAGE_BITS + HEAP_TABLE_BITS)];
+    if (*table == NULL) {
+        *table = calloc(1, sizeof(HeapTable));
+        if (*table == NULL) return false;
+    }
+
+    Value **page = &(*table)->pages[((uintptr_t)address >> HEAP_PAGE_BITS) & (HEAP_TABLE_SIZE - 1)];
+    if (*page == NULL) {
+        *page = page_new();
+        if (*page == NULL) return false;
+        heap->pages++;
+    }
+
+    (*page)[(uintptr_t)address & (HEAP_PAGE_SIZE - 1)] = value;
+    return true;
+}
+
+// Mark the bignums stored anywhere in the heap
+void heap_mark(const Heap *heap) {
+    for (size_t i = 0; i < HEAP_DIRECTORY_SIZE; i++) {
+        const HeapTable *table = heap->directory[i];
+        if (table == NULL) continue;
+
+        for (size_t j = 0; j < HEAP_TABLE_SIZE; j++) {
+            const Value *page = table->pages[j];
+            if (page == NULL) continue;
+
+            for (size_t k = 0; k < HEAP_PAGE_SIZE; k++) {
+                bigpool_mark(page[k]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < heap->sparse_capacity; i++) {
+        if (heap->sparse[i].used) bigpool_mark(heap->sparse[i].value);
+    }
+}
+
+// Call visit for every cell that is not zero, dense ones in address order
+void heap_each(const Heap *heap, const HeapVisit visit, void *user) {
+    for (size_t i = 0; i < HEAP_DIRECTORY_SIZE; i++) {
+        const HeapTable *table = heap->directory[i];
+        if (table == NULL) continue;
+
+        for (size_t j = 0; j < HEAP_TABLE_SIZE; j++) {
+            const Value *page = table->pages[j];
+            if (page == NULL) continue;
+
+            const uintptr_t base = (i << (HEAP_PAGE_BITS + HEAP_TABLE_BITS)) | (j << HEAP_PAGE_BITS);
+            for (size_t k = 0; k < HEAP_PAGE_SIZE; k++) {
+                if (page[k] != 0) visit(user, (intptr_t)(base | k), page[k]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < heap->sparse_capacity; i++) {
+        const HeapEntry *entry = &heap->sparse[i];
+        if (entry->used && entry->value != 0) visit(user, entry->address, entry->value);
+    }
+}
+
+void heap_report(FILE *out, const Heap *heap) {
+    fprintf(out, "Heap: %zu pages touched (%zu KB), %zu sparse cells\n",
+            heap->pages, heap->pages * PAGE_BYTES / 1024, heap->sparse_count);
+}
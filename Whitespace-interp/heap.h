@@ -0,0 +1,79 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "value.h"
+
+// Dense addresses [0, HEAP_DENSE_LIMIT) go through a two-level page table:
+// directory -> table -> page of cells. Tables and pages are allocated on
+// first store, so untouched parts of the heap cost nothing.
+#define HEAP_PAGE_BITS 12
+#define HEAP_TABLE_BITS 10
+#if UINTPTR_MAX > 0xFFFFFFFFu
+    #define HEAP_DIRECTORY_BITS 10
+#else
+    #define HEAP_DIRECTORY_BITS 8
+#endif
+
+#define HEAP_PAGE_SIZE ((uintptr_t)1 << HEAP_PAGE_BITS)
+#define HEAP_TABLE_SIZE ((uintptr_t)1 << HEAP_TABLE_BITS)
+#define HEAP_DIRECTORY_SIZE ((uintptr_t)1 << HEAP_DIRECTORY_BITS)
+#define HEAP_TABLE_SPAN (HEAP_PAGE_SIZE << HEAP_TABLE_BITS)
+#define HEAP_DENSE_LIMIT ((uintptr_t)1 << (HEAP_PAGE_BITS + HEAP_TABLE_BITS + HEAP_DIRECTORY_BITS))
+
+typedef struct {
+    Value* pages[HEAP_TABLE_SIZE];
+} HeapTable;
+
+// Cell outside the dense range (negative or very large address)
+typedef struct {
+    intptr_t address;
+    Value value;
+    bool used;
+} HeapEntry;
+
+typedef struct {
+    HeapTable low;              // First table, inline so low addresses skip a load
+    HeapTable* directory[HEAP_DIRECTORY_SIZE];  // directory[0] is &low
+    size_t pages;               // Pages touched so far
+    HeapEntry* sparse;          // Open addressing, power of two capacity
+    size_t sparse_count;
+    size_t sparse_capacity;
+} Heap;
+
+typedef void (*HeapVisit)(void *user, intptr_t address, Value value);
+
+void heap_init(Heap *heap);
+void heap_free(Heap *heap);
+Value heap_load(const Heap *heap, intptr_t address);
+bool heap_store(Heap *heap, intptr_t address, Value value);
+void heap_mark(const Heap *heap);
+void heap_each(const Heap *heap, HeapVisit visit, void *user);
+void heap_report(FILE *out, const Heap *heap);
+
+// Cell of a dense address whose page exists, NULL otherwise. Negative
+// addresses wrap around to huge unsigned ones and miss as well
+static inline Value* heap_find(const Heap *heap, const uintptr_t address) {
+    const HeapTable *table;
+    if (address < HEAP_TABLE_SPAN) {
+        table = &heap->low;
+    } else {
+        if (address >= HEAP_DENSE_LIMIT) return NULL;
+        table = heap->directory[address >> (HEAP_PAGE_BITS + HEAP_TABLE_BITS)];
+        if (table == NULL) return NULL;
+    }
+
+    Value *page = table->pages[(address >> HEAP_PAGE_BITS) & (HEAP_TABLE_SIZE - 1)];
+    if (page == NULL) return NULL;
+
+    return &page[address & (HEAP_PAGE_SIZE - 1)];
+}
+
+#endif //HEAP_H
@@ -3,160 +3,242 @@
 //
 
 #include "interpreter.h"
+#include "instruction.h"
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-// ARITHMETIC OPERATIONS
+const char* const opcode_names[OP_COUNT] = {
+    [OP_PUSH]               = "push",
+    [OP_PUSH_CONST]         = "push",
+    [OP_COPY]               = "copy",
+    [OP_SLIDE]              = "slide",
+    [OP_DUP]                = "dup",
+    [OP_SWAP]               = "swap",
+    [OP_DISCARD]            = "discard",
+    [OP_ADD]                = "add",
+    [OP_SUB]                = "sub",
+    [OP_MUL]                = "mul",
+    [OP_DIV]                = "div",
+    [OP_MOD]                = "mod",
+    [OP_STORE]              = "store",
+    [OP_RETRIEVE]           = "retrieve",
+    [OP_OUT_CHAR]           = "outchar",
+    [OP_OUT_NUM]            = "outnum",
+    [OP_IN_CHAR]            = "inchar",
+    [OP_IN_NUM]             = "innum",
+    [OP_CALL]               = "call",
+    [OP_JUMP]               = "jump",
+    [OP_JZ]                 = "jz",
+    [OP_JN]                 = "jn",
+    [OP_RET]                = "ret",
+    [OP_END]                = "end",
+    [OP_PUSH_ADD]           = "push+add",
+    [OP_PUSH_SUB]           = "push+sub",
+    [OP_PUSH_MUL]           = "push+mul",
+    [OP_PUSH_STORE]         = "push+store",
+    [OP_PUSH_PUSH_STORE]    = "push+push+store",
+    [OP_PUSH_RETRIEVE]      = "push+retrieve",
+    [OP_PUSH_OUT_CHAR]      = "push+outchar",
+    [OP_DUP_JZ]             = "dup+jz",
+    [OP_DUP_JN]             = "dup+jn",
+    [OP_SUB_JZ]             = "sub+jz",
+    [OP_SWAP_SUB]           = "swap+sub",
+    [OP_PUSH_SUB_DUP_JN]    = "push+sub+dup+jn",
+    [OP_COPY_UNCHECKED]             = "copy",
+    [OP_SLIDE_UNCHECKED]            = "slide",
+    [OP_DUP_UNCHECKED]              = "dup",
+    [OP_SWAP_UNCHECKED]             = "swap",
+    [OP_DISCARD_UNCHECKED]          = "discard",
+    [OP_ADD_UNCHECKED]              = "add",
+    [OP_SUB_UNCHECKED]              = "sub",
+    [OP_MUL_UNCHECKED]              = "mul",
+    [OP_DIV_UNCHECKED]              = "div",
+    [OP_MOD_UNCHECKED]              = "mod",
+    [OP_STORE_UNCHECKED]            = "store",
+    [OP_RETRIEVE_UNCHECKED]         = "retrieve",
+    [OP_JZ_UNCHECKED]               = "jz",
+    [OP_JN_UNCHECKED]               = "jn",
+    [OP_PUSH_ADD_UNCHECKED]         = "push+add",
+    [OP_PUSH_SUB_UNCHECKED]         = "push+sub",
+    [OP_PUSH_MUL_UNCHECKED]         = "push+mul",
+    [OP_PUSH_STORE_UNCHECKED]       = "push+store",
+    [OP_DUP_JZ_UNCHECKED]           = "dup+jz",
+    [OP_DUP_JN_UNCHECKED]           = "dup+jn",
+    [OP_SUB_JZ_UNCHECKED]           = "sub+jz",
+    [OP_SWAP_SUB_UNCHECKED]         = "swap+sub",
+    [OP_PUSH_SUB_DUP_JN_UNCHECKED]  = "push+sub+dup+jn",
+};
+
+// Results may be new bignums: collect once enough of them piled up.
+// Called after the result is stored, so it is already reachable
+static void maybe_collect(Interpreter* interpreter) {
+    if (interpreter->bigs.count >= interpreter->bigs.threshold) {
+        interpreter_collect(interpreter);
+    }
+}
 
-void instr_add(Interpreter* interpreter) {
-    if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Add: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
-        return;
+// Any small value is a heap address, negative ones included
+static bool heap_address(Interpreter* interpreter, const Value address, const char* what, intptr_t* out) {
+    if (value_is_small(address)) {
+        *out = value_small(address);
+        return true;
     }
 
-    int b = st_pop(interpreter->stack);
-    int a = st_pop(interpreter->stack);
+    char *text = malloc(value_format_size(address) + 1);
+    if (text != NULL) {
+        text[value_format(address, text)] = '\0';
+        interpreter_error(interpreter, "%s: address %s out of range at line %d\n",
+                          what, text, interpreter_current_line(interpreter));
+        free(text);
+    } else {
+        interpreter_error(interpreter, "%s: address out of range at line %d\n",
+                          what, interpreter_current_line(interpreter));
+    }
+    return false;
+}
 
-    // Overflow check
-    long long result = (long long)a + (long long)b;
-    if (result > INT_MAX || result < INT_MIN) {
-        fprintf(stderr, "Add: integer overflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
-        return;
+static void heap_put(Interpreter* interpreter, const intptr_t address, const Value value, const char* what) {
+    if (!heap_store(&interpreter->heap, address, value)) {
+        interpreter_error(interpreter, "%s: out of heap memory at line %d\n", what, interpreter_current_line(interpreter));
     }
+}
 
-    st_push(interpreter->stack, a + b);
+// Stops the program once the stack is at its maximum (only without
+// WS_STACK_GUARD; with it, an overflow faults in st_push, see guard.c)
+static void push_value(Interpreter* interpreter, const Value value) {
+    if (!st_push(interpreter->stack, value)) {
+        interpreter_error(interpreter, "Stack overflow (max %d) at line %d\n",
+                          interpreter->stack->maximum, interpreter_current_line(interpreter));
+    }
 }
 
-void instr_sub(Interpreter* interpreter) {
+// ARITHMETIC OPERATIONS
+
+void instr_add(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Sub: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Add: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int b = st_pop(interpreter->stack);
-    int a = st_pop(interpreter->stack);
+    Value b = st_pop(interpreter->stack);
+    Value a = st_pop(interpreter->stack);
 
-    st_push(interpreter->stack, a - b);
+    push_value(interpreter, value_add(&interpreter->bigs, a, b));
+    maybe_collect(interpreter);
 }
 
-void instr_mul(Interpreter* interpreter) {
+void instr_sub(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Mul: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Sub: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int b = st_pop(interpreter->stack);
-    int a = st_pop(interpreter->stack);
+    Value b = st_pop(interpreter->stack);
+    Value a = st_pop(interpreter->stack);
 
-    // Overflow check
-    if (a != 0 && b != 0) {
-        long long result = (long long)a * (long long)b;
-        if (result > INT_MAX || result < INT_MIN) {
-            fprintf(stderr, "Mul: integer overflow at line %d\n", interpreter->parser.line);
-            interpreter->running = false;
-            return;
-        }
+    push_value(interpreter, value_sub(&interpreter->bigs, a, b));
+    maybe_collect(interpreter);
+}
+
+void instr_mul(Interpreter* interpreter, int operand) {
+    if (interpreter->stack->top < 1) {
+        interpreter_error(interpreter, "Mul: stack underflow at line %d\n", interpreter_current_line(interpreter));
+        return;
     }
 
-    st_push(interpreter->stack, a * b);
+    Value b = st_pop(interpreter->stack);
+    Value a = st_pop(interpreter->stack);
+
+    push_value(interpreter, value_mul(&interpreter->bigs, a, b));
+    maybe_collect(interpreter);
 }
 
-void instr_div(Interpreter* interpreter) {
+void instr_div(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Div: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Div: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int b = st_pop(interpreter->stack);
-    int a = st_pop(interpreter->stack);
+    Value b = st_pop(interpreter->stack);
+    Value a = st_pop(interpreter->stack);
 
-    if (b == 0) {
-        fprintf(stderr, "Div: divide by zero at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+    if (b == value_from_small(0)) {
+        interpreter_error(interpreter, "Div: divide by zero at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    st_push(interpreter->stack, a / b);
+    push_value(interpreter, value_div(&interpreter->bigs, a, b));
+    maybe_collect(interpreter);
 }
 
-void instr_mod(Interpreter* interpreter) {
+void instr_mod(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Mod: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Mod: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int b = st_pop(interpreter->stack);
-    int a = st_pop(interpreter->stack);
+    Value b = st_pop(interpreter->stack);
+    Value a = st_pop(interpreter->stack);
 
-    if (b == 0) {
-        fprintf(stderr, "Mod: modulo by zero at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+    if (b == value_from_small(0)) {
+        interpreter_error(interpreter, "Mod: modulo by zero at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    st_push(interpreter->stack, a % b);
+    push_value(interpreter, value_mod(&interpreter->bigs, a, b));
+    maybe_collect(interpreter);
 }
 
 // HEAP OPERATIONS
 
-void instr_heap_store(Interpreter* interpreter) {
+void instr_heap_store(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Heap store: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Heap store: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int value = st_pop(interpreter->stack);
-    int address = st_pop(interpreter->stack);
+    Value value = st_pop(interpreter->stack);
+    Value address = st_pop(interpreter->stack);
 
-    if (address < 0 || address >= HEAP_SIZE) {
-        fprintf(stderr, "Heap store: address %d out of bounds [0, %d) at line %d\n",
-                address, HEAP_SIZE, interpreter->parser.line);
-        interpreter->running = false;
+    intptr_t index = 0;
+    if (!heap_address(interpreter, address, "Heap store", &index)) {
         return;
     }
 
-    interpreter->heap[address] = value;
+    heap_put(interpreter, index, value, "Heap store");
 }
 
-void instr_heap_retrieve(Interpreter* interpreter) {
+void instr_heap_retrieve(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Heap retrieve: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Heap retrieve: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int address = st_pop(interpreter->stack);
+    Value address = st_pop(interpreter->stack);
 
-    if (address < 0 || address >= HEAP_SIZE) {
-        fprintf(stderr, "Heap retrieve: address %d out of bounds [0, %d) at line %d\n",
-                address, HEAP_SIZE, interpreter->parser.line);
-        interpreter->running = false;
+    intptr_t index = 0;
+    if (!heap_address(interpreter, address, "Heap retrieve", &index)) {
         return;
     }
 
-    st_push(interpreter->stack, interpreter->heap[address]);
+    push_value(interpreter, heap_load(&interpreter->heap, index));
 }
 
 // I/O OPERATIONS
 
-void instr_out_char(Interpreter *interpreter) {
+void instr_out_char(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Out char: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Out char: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int value = st_pop(interpreter->stack);
+    io_write_char(interpreter, value_to_char(st_pop(interpreter->stack)));
+}
 
+void io_write_char(Interpreter* interpreter, int value) {
 #ifdef DEBUG
+    output_flush(&interpreter->output);
     printf("\n[DEBUG] Out char: ");
     if (value > 32 && value <= 126) {
         printf("'%c' (ASCII %d)\n", value, value);
@@ -173,68 +255,64 @@ void instr_out_char(Interpreter *interpreter) {
     }
 #endif
 
-    putchar(value);
-    fflush(stdout);
+    output_char(&interpreter->output, value);
 }
 
-void instr_out_num(Interpreter* interpreter) {
+void instr_out_num(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Out num: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Out num: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int value = st_pop(interpreter->stack);
+    Value value = st_pop(interpreter->stack);
 
 #ifdef DEBUG
-    printf("\n[DEBUG] Out num: %d\n", value);
+    output_flush(&interpreter->output);
+    printf("\n[DEBUG] Out num: ");
+    value_fprint(stdout, value);
+    printf("\n");
 #endif
 
-    printf("%d", value);
-    fflush(stdout);
+    output_number(&interpreter->output, value);
 }
 
-void instr_in_char(Interpreter* interpreter) {
+void instr_in_char(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "In char: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "In char: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int address = st_pop(interpreter->stack);
+    Value address = st_pop(interpreter->stack);
 
-    if (address < 0 || address >= HEAP_SIZE) {
-        fprintf(stderr, "In char: address %d out of bounds [0, %d) at line %d\n",
-                address, HEAP_SIZE, interpreter->parser.line);
-        interpreter->running = false;
+    intptr_t index = 0;
+    if (!heap_address(interpreter, address, "In char", &index)) {
         return;
     }
 
-    fflush(stdout);
-    fflush(stderr);
+    if (interpreter->input.interactive) {
+        output_flush(&interpreter->output);
+        fflush(stderr);
+    }
 
-    int c = getchar();
+    int c = input_char(&interpreter->input);
 
     if (c == EOF) {
         c = -1;
     }
 
-    interpreter->heap[address] = c;
+    heap_put(interpreter, index, value_from_small(c), "In char");
 }
 
-void instr_in_num(Interpreter* interpreter) {
+void instr_in_num(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "In num: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "In num: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int address = st_pop(interpreter->stack);
+    Value address = st_pop(interpreter->stack);
 
-    if (address < 0 || address >= HEAP_SIZE) {
-        fprintf(stderr, "In num: address %d out of bounds [0, %d) at line %d\n",
-                address, HEAP_SIZE, interpreter->parser.line);
-        interpreter->running = false;
+    intptr_t index = 0;
+    if (!heap_address(interpreter, address, "In num", &index)) {
         return;
     }
 
@@ -242,278 +320,184 @@ void instr_in_num(Interpreter* interpreter) {
     printf("[DEBUG] Reading number input: ");
 #endif
 
-    fflush(stdout);
-    fflush(stderr);
-
-    char buffer[32] = {0};
-    int c;
-
-    // Skip leading whitespace (spaces and tabs only)
-    do {
-        c = getchar();
-        if (c == EOF) {
-            interpreter->heap[address] = 0;
-            return;
-        }
-    } while (c == ' ' || c == '\t');
-
-    // Empty line = 0
-    if (c == '\n') {
-        interpreter->heap[address] = 0;
-        return;
-    }
-
-    // Build number string
-    buffer[0] = (char)c;
-    int i = 1;
-
-    while (i < 31) {
-        c = getchar();
-        if (c == EOF || c == '\n' || c == ' ' || c == '\t') {
-            break;
-        }
-        buffer[i++] = (char)c;
+    if (interpreter->input.interactive) {
+        output_flush(&interpreter->output);
+        fflush(stderr);
     }
-    buffer[i] = '\0';
 
-    // Parse the number
-    int value = 0;
-    int sign = 1;
-    int j = 0;
-
-    if (buffer[0] == '-') {
-        sign = -1;
-        j = 1;
-    } else if (buffer[0] == '+') {
-        j = 1;
-    }
-
-    for (; buffer[j] != '\0'; j++) {
-        if (buffer[j] >= '0' && buffer[j] <= '9') {
-            value = value * 10 + (buffer[j] - '0');
-        } else {
-            // Invalid character in number
-            break;
-        }
-    }
+    const Value value = input_number(&interpreter->input, &interpreter->bigs);
 
 #ifdef DEBUG
-    printf("[DEBUG]%d\n", sign * value);
+    printf("[DEBUG]");
+    value_fprint(stdout, value);
+    printf("\n");
 #endif
 
-    interpreter->heap[address] = sign * value;
-
-    // Consume rest of line
-    if (c != '\n' && c != EOF) {
-        while ((c = getchar()) != '\n' && c != EOF) {
-            // Skip to end of line
-        }
-    }
+    heap_put(interpreter, index, value, "In num");
+    maybe_collect(interpreter);
 }
 
 // FLOW CONTROL HELPERS
 
-void fc_add_label(Interpreter* interpreter, int label, int position) {
-    if (interpreter->label_count >= MAX_LABELS) {
-        fprintf(stderr, "Too many labels (max %d) at line %d\n",
-                MAX_LABELS, interpreter->parser.line);
-        interpreter->running = false;
-        return;
-    }
-
-    // Check if label already exists (update position)
-    for (int i = 0; i < interpreter->label_count; i++) {
-        if (interpreter->labels[i].address == label) {
-            interpreter->labels[i].position = position;
-            return;
-        }
-    }
-
-    // Add new label
-    interpreter->labels[interpreter->label_count].address = label;
-    interpreter->labels[interpreter->label_count].position = position;
-    interpreter->label_count++;
-}
-
-// Returns position if found, -1 if not found
-int fc_find_label(Interpreter* interpreter, int label) {
-    for (int i = 0; i < interpreter->label_count; i++) {
-        if (interpreter->labels[i].address == label) {
-            return interpreter->labels[i].position;
-        }
+// Targets are resolved at load time; a negative operand is -(label id + 1)
+// of a label that was never marked
+static bool fc_check_target(Interpreter* interpreter, int operand) {
+    if (operand >= 0) {
+        return true;
     }
 
-    fprintf(stderr, "Undefined label: %d at line %d\n", label, interpreter->parser.line);
-    interpreter->running = false;
-    return -1;
+    interpreter_error(interpreter, "Undefined label: %s at line %d\n",
+            interpreter->labels.entries[-operand - 1].name, interpreter_current_line(interpreter));
+    return false;
 }
 
 // FLOW CONTROL INSTRUCTIONS
 
-void instr_mark(Interpreter* interpreter) {
-    int label = parse_label(&interpreter->parser);
-    fc_add_label(interpreter, label, interpreter->parser.position);
-}
-
-void instr_call_subroutine(Interpreter* interpreter) {
-    int label = parse_label(&interpreter->parser);
-    int target = fc_find_label(interpreter, label);
-
-    if (target < 0) {
-        // Error already reported, running = false
+void instr_call_subroutine(Interpreter* interpreter, int operand) {
+    if (!fc_check_target(interpreter, operand)) {
         return;
     }
 
-    if (interpreter->call_stack->top >= CALL_STACK_SIZE - 1) {
-        fprintf(stderr, "Call stack overflow (max %d) at line %d\n",
-                CALL_STACK_SIZE, interpreter->parser.line);
-        interpreter->running = false;
+#if !WS_STACK_GUARD
+    Stack *calls = interpreter->call_stack;
+    if (calls->top >= calls->capacity - 1 && !st_reserve(calls, calls->top + 2)) {
+        interpreter_error(interpreter, "Call stack overflow (max %d) at line %d\n",
+                calls->maximum, interpreter_current_line(interpreter));
         return;
     }
+#endif
 
-    // Push return address and jump
-    interpreter->call_stack->data[++interpreter->call_stack->top] = interpreter->parser.position;
-    interpreter->parser.position = target;
+    // Push return address (a plain index, not a tagged value) and jump
+    interpreter->call_stack->data[++interpreter->call_stack->top] = interpreter->pc;
+    interpreter->pc = operand;
 }
 
-void instr_jump(Interpreter* interpreter) {
-    int label = parse_label(&interpreter->parser);
-    int target = fc_find_label(interpreter, label);
-
-    if (target < 0) {
+void instr_jump(Interpreter* interpreter, int operand) {
+    if (!fc_check_target(interpreter, operand)) {
         return;
     }
 
-    interpreter->parser.position = target;
+    interpreter->pc = operand;
 }
 
-void instr_jump_if_zero(Interpreter* interpreter) {
-    int label = parse_label(&interpreter->parser);
-    int target = fc_find_label(interpreter, label);
-
-    if (target < 0) {
+void instr_jump_if_zero(Interpreter* interpreter, int operand) {
+    if (!fc_check_target(interpreter, operand)) {
         return;
     }
 
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Jump if zero: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Jump if zero: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int value = st_pop(interpreter->stack);
+    Value value = st_pop(interpreter->stack);
 
-    if (value == 0) {
-        interpreter->parser.position = target;
+    if (value == value_from_small(0)) {
+        interpreter->pc = operand;
     }
 }
 
-void instr_jump_if_neg(Interpreter* interpreter) {
-    int label = parse_label(&interpreter->parser);
-    int target = fc_find_label(interpreter, label);
-
-    if (target < 0) {
+void instr_jump_if_neg(Interpreter* interpreter, int operand) {
+    if (!fc_check_target(interpreter, operand)) {
         return;
     }
 
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Jump if negative: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Jump if negative: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int value = st_pop(interpreter->stack);
+    Value value = st_pop(interpreter->stack);
 
-    if (value < 0) {
-        interpreter->parser.position = target;
+    if (value_is_negative(value)) {
+        interpreter->pc = operand;
     }
 }
 
-void instr_ret(Interpreter* interpreter) {
+void instr_ret(Interpreter* interpreter, int operand) {
     if (interpreter->call_stack->top < 0) {
-        fprintf(stderr, "Return with empty call stack at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Return with empty call stack at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
     // Pop return address and jump back
-    int ret_pos = interpreter->call_stack->data[interpreter->call_stack->top--];
-    interpreter->parser.position = ret_pos;
+    int ret_pos = (int)interpreter->call_stack->data[interpreter->call_stack->top--];
+    interpreter->pc = ret_pos;
 }
 
-void instr_end(Interpreter* interpreter) {
+void instr_end(Interpreter* interpreter, int operand) {
     interpreter->running = false;
 }
 
 
-void instr_push(Interpreter* interpreter) {
-    int value = parse_number(&interpreter->parser);
-    if (interpreter->running == false) return;
-    st_push(interpreter->stack, value);
+void instr_push(Interpreter* interpreter, int operand) {
+    push_value(interpreter, value_from_small(operand));
+}
+
+void instr_push_const(Interpreter* interpreter, int operand) {
+    push_value(interpreter, interpreter->program.constants[operand]);
 }
 
-void instr_duplicate(Interpreter* interpreter) {
+void instr_duplicate(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Duplicate: stack underflow at line %d\n",
-                interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Duplicate: stack underflow at line %d\n",
+                interpreter_current_line(interpreter));
         return;
     }
-    int value = st_peek(interpreter->stack, 0);
-    st_push(interpreter->stack, value);
+    Value value = st_peek(interpreter->stack, 0);
+    push_value(interpreter, value);
 }
 
-void instr_copy(Interpreter* interpreter) {
-    int n = parse_number(&interpreter->parser);
-    if (!interpreter->running) return;
+void instr_copy(Interpreter* interpreter, int operand) {
+    int n = operand;
+
+    if (n < 0) {
+        interpreter_error(interpreter, "Copy: negative index %d at line %d\n", n, interpreter_current_line(interpreter));
+        return;
+    }
 
     if (interpreter->stack->top - n < 0) {
-        fprintf(stderr, "Copy: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Copy: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int value = st_peek(interpreter->stack, n);
-    st_push(interpreter->stack, value);
+    Value value = st_peek(interpreter->stack, n);
+    push_value(interpreter, value);
 }
 
-void instr_slide(Interpreter* interpreter) {
-    int n = parse_number(&interpreter->parser);
-    if (!interpreter->running) return;
+void instr_slide(Interpreter* interpreter, int operand) {
+    int n = operand;
 
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Slide: stack underflow at line %d\n", interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Slide: stack underflow at line %d\n", interpreter_current_line(interpreter));
         return;
     }
 
-    int top = st_pop(interpreter->stack);
+    Value top = st_pop(interpreter->stack);
     if (n > 0 && interpreter->stack->top >= n - 1) {
         interpreter->stack->top -= n;
     } else if (n > 0) {
         interpreter->stack->top = -1;
     }
-    st_push(interpreter->stack, top);
+    push_value(interpreter, top);
 }
 
-void instr_swap(Interpreter* interpreter) {
+void instr_swap(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 1) {
-        fprintf(stderr, "Swap: stack underflow at line %d\n",
-                interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Swap: stack underflow at line %d\n",
+                interpreter_current_line(interpreter));
         return;
     }
-    int a = st_pop(interpreter->stack);
-    int b = st_pop(interpreter->stack);
-    st_push(interpreter->stack, a);
-    st_push(interpreter->stack, b);
+    Value a = st_pop(interpreter->stack);
+    Value b = st_pop(interpreter->stack);
+    push_value(interpreter, a);
+    push_value(interpreter, b);
 }
 
-void instr_discard(Interpreter* interpreter) {
+void instr_discard(Interpreter* interpreter, int operand) {
     if (interpreter->stack->top < 0) {
-        fprintf(stderr, "Discard: stack underflow at line %d\n",
-                interpreter->parser.line);
-        interpreter->running = false;
+        interpreter_error(interpreter, "Discard: stack underflow at line %d\n",
+                interpreter_current_line(interpreter));
         return;
     }
     st_pop(interpreter->stack);
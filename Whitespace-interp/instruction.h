@@ -7,36 +7,121 @@
 
 #include "interpreter.h"
 
-void instr_push(Interpreter* interpreter);
-void instr_duplicate(Interpreter* interpreter);
-void instr_discard(Interpreter* interpreter);
-void instr_add(Interpreter* interpreter);
-void instr_sub(Interpreter* interpreter);
-void instr_mul(Interpreter* interpreter);
-void instr_div(Interpreter* interpreter);
-void instr_mod(Interpreter* interpreter);
-void instr_heap_store(Interpreter* interpreter);
-void instr_heap_retrieve(Interpreter* interpreter);
-void instr_copy(Interpreter* interpreter);
-void instr_slide(Interpreter* interpreter);
-void instr_swap(Interpreter* interpreter);
-void instr_mark(Interpreter* interpreter);
-void instr_call_subroutine(Interpreter* interpreter);
-void instr_jump(Interpreter* interpreter);
-void instr_jump_if_zero(Interpreter* interpreter);
-void instr_jump_if_neg(Interpreter* interpreter);
-void instr_ret(Interpreter* interpreter);
-void instr_end(Interpreter* interpreter);
-void instr_out_char(Interpreter* interpreter);
-void instr_out_num(Interpreter* interpreter);
-void instr_in_char(Interpreter* interpreter);
-void instr_in_num(Interpreter* interpreter);
-void fc_add_label(Interpreter* interpreter, int label, int position);
-void fc_find_label(Interpreter* interpreter, int label);
+// Decoded opcodes. Label marks are resolved while decoding and never executed
+typedef enum {
+    // STACK
+    OP_PUSH,
+    OP_PUSH_CONST,          // push of a number that does not fit an operand
+    OP_COPY,
+    OP_SLIDE,
+    OP_DUP,
+    OP_SWAP,
+    OP_DISCARD,
+
+    // ARITHMETIC
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+
+    // HEAP
+    OP_STORE,
+    OP_RETRIEVE,
+
+    // I/O
+    OP_OUT_CHAR,
+    OP_OUT_NUM,
+    OP_IN_CHAR,
+    OP_IN_NUM,
+
+    // FLOW
+    OP_CALL,
+    OP_JUMP,
+    OP_JZ,
+    OP_JN,
+    OP_RET,
+    OP_END,
+
+    // FUSED (see fusion.c). The slots covered by a fused instruction keep
+    // the original ones, so jumps into the middle of a sequence still work
+    OP_PUSH_ADD,            // push n; add
+    OP_PUSH_SUB,            // push n; sub
+    OP_PUSH_MUL,            // push n; mul
+    OP_PUSH_STORE,          // push v; store
+    OP_PUSH_PUSH_STORE,     // push a; push v; store
+    OP_PUSH_RETRIEVE,       // push a; retrieve
+    OP_PUSH_OUT_CHAR,       // push c; outchar
+    OP_DUP_JZ,              // dup; jz L
+    OP_DUP_JN,              // dup; jn L
+    OP_SUB_JZ,              // sub; jz L
+    OP_SWAP_SUB,            // swap; sub
+    OP_PUSH_SUB_DUP_JN,     // push n; sub; dup; jn L
+
+    // UNCHECKED (see verify.c): the same instructions where the stack is
+    // proven deep enough at load, so the engines skip the underflow check
+    OP_COPY_UNCHECKED,
+    OP_SLIDE_UNCHECKED,
+    OP_DUP_UNCHECKED,
+    OP_SWAP_UNCHECKED,
+    OP_DISCARD_UNCHECKED,
+    OP_ADD_UNCHECKED,
+    OP_SUB_UNCHECKED,
+    OP_MUL_UNCHECKED,
+    OP_DIV_UNCHECKED,
+    OP_MOD_UNCHECKED,
+    OP_STORE_UNCHECKED,
+    OP_RETRIEVE_UNCHECKED,
+    OP_JZ_UNCHECKED,
+    OP_JN_UNCHECKED,
+    OP_PUSH_ADD_UNCHECKED,
+    OP_PUSH_SUB_UNCHECKED,
+    OP_PUSH_MUL_UNCHECKED,
+    OP_PUSH_STORE_UNCHECKED,
+    OP_DUP_JZ_UNCHECKED,
+    OP_DUP_JN_UNCHECKED,
+    OP_SUB_JZ_UNCHECKED,
+    OP_SWAP_SUB_UNCHECKED,
+    OP_PUSH_SUB_DUP_JN_UNCHECKED,
+
+    OP_COUNT
+} Opcode;
+
+extern const char* const opcode_names[OP_COUNT];
+
+// Reference handler of each opcode, fused ones run their first instruction
+// and unchecked ones the checked handler
+extern void (*const handler_table[OP_COUNT])(Interpreter*, int);
+
+void instr_push(Interpreter* interpreter, int operand);
+void instr_push_const(Interpreter* interpreter, int operand);
+void instr_duplicate(Interpreter* interpreter, int operand);
+void instr_discard(Interpreter* interpreter, int operand);
+void instr_add(Interpreter* interpreter, int operand);
+void instr_sub(Interpreter* interpreter, int operand);
+void instr_mul(Interpreter* interpreter, int operand);
+void instr_div(Interpreter* interpreter, int operand);
+void instr_mod(Interpreter* interpreter, int operand);
+void instr_heap_store(Interpreter* interpreter, int operand);
+void instr_heap_retrieve(Interpreter* interpreter, int operand);
+void instr_copy(Interpreter* interpreter, int operand);
+void instr_slide(Interpreter* interpreter, int operand);
+void instr_swap(Interpreter* interpreter, int operand);
+void instr_call_subroutine(Interpreter* interpreter, int operand);
+void instr_jump(Interpreter* interpreter, int operand);
+void instr_jump_if_zero(Interpreter* interpreter, int operand);
+void instr_jump_if_neg(Interpreter* interpreter, int operand);
+void instr_ret(Interpreter* interpreter, int operand);
+void instr_end(Interpreter* interpreter, int operand);
+void instr_out_char(Interpreter* interpreter, int operand);
+void instr_out_num(Interpreter* interpreter, int operand);
+void instr_in_char(Interpreter* interpreter, int operand);
+void instr_in_num(Interpreter* interpreter, int operand);
+void io_write_char(Interpreter* interpreter, int value);
 char parse_next_char(ParserState *parser);
 char parse_peek_char(ParserState *parser);
 void parse_skip_ws(ParserState *parser);
-int parse_number(ParserState *parser);
+Value parse_number(ParserState *parser);
 int parse_label(ParserState *parser);
 
 #endif //INSTRUCTION_H
@@ -3,45 +3,95 @@
 //
 
 #include "interpreter.h"
+#include "jit.h"
+#include "cache.h"
+#include "guard.h"
 #include "config.h"
+#include "source.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-Stack* st_new(const int capacity) {
+// Slots a growing stack starts with
+#define STACK_INITIAL 1024
+
+// A stack of up to maximum values. With WS_STACK_GUARD all of it is
+// reserved at once in front of a guard page (guard.c); otherwise it starts
+// small and st_reserve grows it
+Stack* st_new(const int maximum) {
     Stack *stack = (Stack *)malloc(sizeof(Stack));
     if (stack == NULL) {
         return NULL;
     }
 
-    stack->data = (int *)malloc(sizeof(int) * capacity);
-    if (stack->data == NULL) {
+    // One spare slot below data[0]: the threaded loop spills its cached
+    // top of stack there when the stack is empty, without a branch
+#if WS_STACK_GUARD
+    const int capacity = maximum;
+    Value *base = guard_map(capacity + 1);
+#else
+    const int capacity = maximum < STACK_INITIAL ? maximum : STACK_INITIAL;
+    Value *base = (Value *)malloc(sizeof(Value) * (capacity + 1));
+#endif
+    if (base == NULL) {
         free(stack);
         return NULL;
     }
 
+    base[0] = 0;
+    stack->data = base + 1;
+
     stack->capacity = capacity;
+    stack->maximum = maximum;
     stack->top = -1;
 
     return stack;
 }
 
 void st_free(Stack *stack) {
-    free(stack->data);
+#if WS_STACK_GUARD
+    guard_unmap(stack->data - 1, stack->capacity + 1);
+#else
+    free(stack->data - 1);
+#endif
     free(stack);
 }
 
-bool st_push(Stack *stack, const int value) {
-    if (stack->top >= stack->capacity - 1) {
-        fprintf(stderr, "Stack overflow\n");
+// Room for count values. False if that is more than the maximum or memory
+// ran out; data may move
+bool st_reserve(Stack *stack, const int count) {
+    if (count <= stack->capacity) return true;
+    if (count > stack->maximum) return false;
+
+    int capacity = stack->capacity;
+    while (capacity < count) {
+        capacity = capacity > stack->maximum / 2 ? stack->maximum : capacity * 2;
+    }
+
+    Value *base = (Value *)realloc(stack->data - 1, sizeof(Value) * ((size_t)capacity + 1));
+    if (base == NULL) return false;
+
+    stack->data = base + 1;
+    stack->capacity = capacity;
+    return true;
+}
+
+// False if the stack is at its maximum
+bool st_push(Stack *stack, const Value value) {
+#if !WS_STACK_GUARD
+    if (stack->top >= stack->capacity - 1 && !st_reserve(stack, stack->top + 2)) {
         return false;
     }
+#endif
 
     stack->data[++stack->top] = value;
     return true;
 }
 
-int st_pop(Stack *stack) {
+Value st_pop(Stack *stack) {
     if (stack->top < 0) {
         // fprintf(stderr, "Stack underflow - empty\n");
         // exit(EXIT_FAILURE);
@@ -51,7 +101,7 @@ int st_pop(Stack *stack) {
     return stack->data[stack->top--];
 }
 
-int st_peek(Stack *stack, const int offset) {
+Value st_peek(Stack *stack, const int offset) {
     if (stack->top - offset < 0) {
         // fprintf(stderr, "Stack: Out of bounds\n");
         // exit(EXIT_FAILURE);
@@ -67,10 +117,28 @@ Interpreter* interpreter_new(void) {
 
     // Initialize to NULL for safe cleanup
     interpreter->stack = NULL;
-    interpreter->heap = NULL;
-    interpreter->labels = NULL;
+    heap_init(&interpreter->heap);
     interpreter->call_stack = NULL;
     interpreter->parser.source = NULL;
+    interpreter->parser.mapping_size = 0;
+    interpreter->parser.tokens = NULL;
+    interpreter->parser.offsets = NULL;
+    interpreter->parser.token_count = 0;
+    interpreter->parser.label = NULL;
+    interpreter->parser.label_capacity = 0;
+    interpreter->parser.warnings = 0;
+    interpreter->parser.owner = interpreter;
+    lt_init(&interpreter->labels);
+    interpreter->program.code = NULL;
+    interpreter->program.lines = NULL;
+    interpreter->program.constants = NULL;
+    interpreter->program.mapping = NULL;
+    interpreter->program.mapping_size = 0;
+    interpreter->program.constant_count = 0;
+    interpreter->program.constant_capacity = 0;
+    bigpool_init(&interpreter->bigs);
+    output_init(&interpreter->output, FLUSH_LINE);
+    input_init(&interpreter->input, &interpreter->output);
 
     interpreter->stack = st_new(STACK_SIZE);
     if (!interpreter->stack) {
@@ -78,30 +146,27 @@ Interpreter* interpreter_new(void) {
         return NULL;
     }
 
-    interpreter->heap = calloc(HEAP_SIZE, sizeof(int));
-    if (!interpreter->heap) {
-        interpreter_delete(interpreter);
-        return NULL;
-    }
-
-    interpreter->labels = malloc(MAX_LABELS * sizeof(Label));
-    if (!interpreter->labels) {
-        interpreter_delete(interpreter);
-        return NULL;
-    }
-
     interpreter->call_stack = st_new(CALL_STACK_SIZE);
     if (!interpreter->call_stack) {
         interpreter_delete(interpreter);
         return NULL;
     }
 
-    interpreter->label_count = 0;
     interpreter->running = true;
+    interpreter->fuse = true;
+    interpreter->optimize = 0;
+    interpreter->failed = false;
+    interpreter->jit = false;
+    interpreter->jit_code = NULL;
+    interpreter->error_write = stream_write_stderr;
+    interpreter->error_user = NULL;
     interpreter->parser.length = 0;
     interpreter->parser.position = 0;
-    interpreter->parser.line = 1;
-    interpreter->parser.col = 1;
+    interpreter->program.length = 0;
+    interpreter->program.capacity = 0;
+    interpreter->pc = 0;
+    interpreter->run_sp = NULL;
+    interpreter->fuel = FUEL_UNLIMITED;
 
     return interpreter;
 }
@@ -109,89 +174,281 @@ Interpreter* interpreter_new(void) {
 void interpreter_delete(Interpreter *interpreter) {
     if (interpreter == NULL) return;
 
+    output_flush(&interpreter->output);
     st_free(interpreter->stack);
-    free(interpreter->heap);
-    free(interpreter->labels);
+    heap_free(&interpreter->heap);
+    lt_free(&interpreter->labels);
     st_free(interpreter->call_stack);
-    free(interpreter->parser.source);
+    source_release(interpreter->parser.source, interpreter->parser.mapping_size);
+    parse_free_tokens(&interpreter->parser);
+    free(interpreter->parser.label);
+    cache_release(&interpreter->program);
+    free(interpreter->program.code);
+    free(interpreter->program.lines);
+    for (int i = 0; i < interpreter->program.constant_count; i++) {
+        value_free_constant(interpreter->program.constants[i]);
+    }
+    free(interpreter->program.constants);
+    jit_free(interpreter->jit_code);
+    bigpool_free(&interpreter->bigs);
+    input_free(&interpreter->input);
     free(interpreter);
 }
 
 int interpreter_read_from_file(Interpreter* interpreter, const char* source) {
-    FILE* file = fopen(source, "rb");
-    if (file == NULL) {
-        perror("Error opening file");
+    if (interpreter_read_source(interpreter, source) != 0) {
         return -1;
     }
 
-    fseek(file, 0, SEEK_END);
-    const long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    return interpreter_decode(interpreter);
+}
 
-    interpreter->parser.source = (char*)malloc(size + 1);
-    if (interpreter->parser.source == NULL) {
-        fclose(file);
-        perror("Error allocating memory");
+// Map a source file for interpreter_decode, or a cache keyed on it
+int interpreter_read_source(Interpreter* interpreter, const char* source) {
+    size_t length = 0;
+    size_t mapping_size = 0;
+    char *data = source_map(source, &length, &mapping_size);
+    if (data == NULL) {
+        interpreter_report(interpreter, "Error opening file: %s\n", strerror(errno));
         return -1;
     }
 
-    fread(interpreter->parser.source, 1, size, file);
-    interpreter->parser.source[size] = NULL_TERM;
-    interpreter->parser.length = size;
+    source_release(interpreter->parser.source, interpreter->parser.mapping_size);
+    interpreter->parser.source = data;
+    interpreter->parser.mapping_size = mapping_size;
+    interpreter->parser.length = (long long)length;
     interpreter->parser.position = 0;
-    interpreter->parser.line = 1;
-    interpreter->parser.col = 1;
-
-    fclose(file);
+    interpreter->parser.warnings = 0;
     return 0;
 }
 
+// FNV-1a of the loaded source, identifies the program in caches and
+// checkpoints
+uint64_t interpreter_source_hash(const Interpreter* interpreter) {
+    const ParserState *parser = &interpreter->parser;
+    uint64_t hash = 14695981039346656037u;
+    for (long long i = 0; i < parser->length; i++) {
+        hash ^= (unsigned char)parser->source[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
 int interpreter_load_str(Interpreter* interpreter, const char* source) {
-    const size_t size = strlen(source);
-    interpreter->parser.source = (char*)malloc(size + 1);
-    if (interpreter->parser.source == NULL)
+    return interpreter_load(interpreter, source, strlen(source));
+}
+
+// Decode source of the given length, which need not be terminated
+int interpreter_load(Interpreter* interpreter, const char* source, const size_t length) {
+    char *copy = (char*)malloc(length + 1);
+    if (copy == NULL) {
+        interpreter_report(interpreter, "Error allocating memory: %s\n", strerror(errno));
         return -1;
+    }
 
-    strcpy(interpreter->parser.source, source);
-    interpreter->parser.length = size;
+    memcpy(copy, source, length);
+    copy[length] = NULL_TERM;
+    source_release(interpreter->parser.source, interpreter->parser.mapping_size);
+    interpreter->parser.source = copy;
+    interpreter->parser.mapping_size = 0;
+    interpreter->parser.length = length;
     interpreter->parser.position = 0;
-    interpreter->parser.line = 1;
-    interpreter->parser.col = 1;
 
+    return interpreter_decode(interpreter);
+}
+
+// Back to the state before the first run, keeping the decoded program
+void interpreter_reset(Interpreter* interpreter) {
+    interpreter->stack->top = -1;
+    interpreter->call_stack->top = -1;
+    heap_free(&interpreter->heap);
+    heap_init(&interpreter->heap);
+    bigpool_free(&interpreter->bigs);
+    bigpool_init(&interpreter->bigs);
+    interpreter->output.length = 0;
+    input_free(&interpreter->input);
+    interpreter->input.eof = false;
+    interpreter->input.error = false;
+    interpreter->pc = 0;
+    interpreter->run_sp = NULL;
+    interpreter->running = true;
+    interpreter->failed = false;
+}
+
+// Line of the instruction being executed, for error messages
+int interpreter_current_line(const Interpreter* interpreter) {
+    const int index = interpreter->pc - 1;
+    if (index < 0 || index >= interpreter->program.length) {
+        // Where the source ends, the line of the final end
+        return interpreter->program.length > 0 ? interpreter->program.lines[interpreter->program.length - 1] : 1;
+    }
+
+    return interpreter->program.lines[index];
+}
+
+static void write_error(Interpreter* interpreter, const char* format, va_list args) {
+    output_flush(&interpreter->output);
+
+    char buffer[256];
+    va_list again;
+    va_copy(again, args);
+    const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+
+    if (length >= (int)sizeof(buffer)) {
+        // Long label names
+        char *message = malloc((size_t)length + 1);
+        if (message != NULL) {
+            vsnprintf(message, (size_t)length + 1, format, again);
+            interpreter->error_write(interpreter->error_user, message, (size_t)length);
+            free(message);
+        }
+    } else if (length > 0) {
+        interpreter->error_write(interpreter->error_user, buffer, (size_t)length);
+    }
+    va_end(again);
+}
+
+// Write a message to the error output, as load diagnostics do. Pending
+// output is written first so stdout and stderr stay in program order
+void interpreter_report(Interpreter* interpreter, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    write_error(interpreter, format, args);
+    va_end(args);
+}
+
+// Report a runtime error and stop
+void interpreter_error(Interpreter* interpreter, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    write_error(interpreter, format, args);
+    va_end(args);
+
+    interpreter->running = false;
+    interpreter->failed = true;
+}
+
+// Mark and sweep the bignums reachable from the value stack and the heap.
+// Return addresses and program constants are never in the pool
+void interpreter_collect(Interpreter* interpreter) {
+    for (int i = 0; i <= interpreter->stack->top; i++) {
+        bigpool_mark(interpreter->stack->data[i]);
+    }
+
+    heap_mark(&interpreter->heap);
+
+    bigpool_sweep(&interpreter->bigs);
+}
+
+// Pick the tokens out of the source for the decoder (see source.c).
+// Returns -1 if the source is too large or memory runs out
+int parse_tokens(ParserState *parser) {
+    parse_free_tokens(parser);
+    if (parser->length > INT_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+
+    const size_t length = (size_t)parser->length;
+    parser->tokens = malloc(length + 1);
+    parser->offsets = malloc((length + 1) * sizeof(int));
+    if (parser->tokens == NULL || parser->offsets == NULL) {
+        parse_free_tokens(parser);
+        return -1;
+    }
+
+    parser->token_count = (int)source_scan(parser->source, length, parser->tokens, parser->offsets);
+    parser->position = 0;
     return 0;
 }
 
+void parse_free_tokens(ParserState *parser) {
+    free(parser->tokens);
+    free(parser->offsets);
+    parser->tokens = NULL;
+    parser->offsets = NULL;
+    parser->token_count = 0;
+}
+
 char parse_next_char(ParserState *parser) {
-    while (parser->position < parser->length) {
-        unsigned char c = parser->source[parser->position++];
-#ifdef DEBUG
-         printf("DEBUG: pos=%d, char=%d ('%c')\n",
-                parser->position-1, c,
-                c == ' ' ? 'S' : c == '\t' ? 'T' : c == '\n' ? 'L' : c == '\r' ? 'R' : '.');
-#endif
-        if (c == SPACE || c == TAB || c == LINEFEED) {
-            if (c == LINEFEED) {
-                parser->line++;
-                parser->col = 1;
-            } else {
-                parser->col++;
-            }
-            return (char)c;
-        }
+    if (parser->position >= parser->token_count) {
+        return EOF;
     }
 
-    return EOF;
+    return parser->tokens[parser->position++];
 }
 
 char parse_peek_char(ParserState *parser) {
-    if (parser->position >= parser->length) {
+    if (parser->position >= parser->token_count) {
         return EOF;
     }
 
-    return parser->source[parser->position];
+    return parser->tokens[parser->position];
+}
+
+// Line just past the token last read, and its column with comments
+// counted if col is given. Only diagnostics ask, so it is worked out from
+// the source rather than counted while parsing
+int parse_location(const ParserState *parser, int *col) {
+    const int end = parser->position > 0 ? parser->offsets[parser->position - 1] + 1 : 0;
+
+    int line = 1;
+    int start = 0;
+    const char *source = parser->source;
+    const char *found;
+    while ((found = memchr(source + start, LINEFEED, (size_t)(end - start))) != NULL) {
+        line++;
+        start = (int)(found - source) + 1;
+    }
+
+    if (col != NULL) *col = end - start + 1;
+    return line;
+}
+
+// Make room for count bits in parser->label
+static bool parse_reserve_bits(ParserState *parser, const size_t count) {
+    if (count < (size_t)parser->label_capacity) {
+        return true;
+    }
+
+    size_t capacity = parser->label_capacity ? (size_t)parser->label_capacity * 2 : 64;
+    while (capacity <= count) capacity *= 2;
+    char *label = capacity <= INT_MAX ? realloc(parser->label, capacity) : NULL;
+    if (label == NULL) {
+        interpreter_report(parser->owner, "Error allocating memory: %s\n", strerror(errno));
+        return false;
+    }
+    parser->label = label;
+    parser->label_capacity = (int)capacity;
+    return true;
+}
+
+// Bits of a number or label up to its linefeed into parser->label, returns
+// their count, -1 if the source ends first and -2 without memory. The
+// linefeed is found with memchr and the tokens before it read in one go
+static int parse_bits(ParserState *parser) {
+    const char *start = parser->tokens + parser->position;
+    const char *end = memchr(start, LINEFEED, (size_t)(parser->token_count - parser->position));
+    if (end == NULL) {
+        parser->position = parser->token_count;
+        return -1;
+    }
+
+    const int length = (int)(end - start);
+    if (!parse_reserve_bits(parser, (size_t)length)) {
+        return -2;
+    }
+    for (int i = 0; i < length; i++) {
+        parser->label[i] = start[i] == TAB ? '1' : '0';
+    }
+
+    parser->position += length + 1;
+    return length;
 }
 
-int parse_number(ParserState *parser) {
+// Numbers have no size limit; the bits go through parser->label so any
+// length becomes a small value or a standalone bignum owned by the caller
+Value parse_number(ParserState *parser) {
 #ifdef DEBUG
     printf("DEBUG parse_number start: pos=%d\n", parser->position);
 #endif
@@ -205,61 +462,44 @@ int parse_number(ParserState *parser) {
     } else if (c == SPACE) {
         sign = 1;
     } else {
-        fprintf(stderr, "Expected sign (space or tab) at line %d, col %d, got: '%c' (ASCII %d)\n",
-                parser->line, parser->col, c, c);
+        // Only a linefeed or the end of the source gets here, named so
+        // the message stays on one line
+        int col;
+        const int line = parse_location(parser, &col);
+        interpreter_report(parser->owner, "Expected sign (space or tab) at line %d, col %d, got: %s\n",
+                           line, col, c == LINEFEED ? "LINEFEED" : "end of file");
+        parser->warnings++;
         return 0;  // Return 0 instead of exit - caller must check running flag
     }
 
     // Read binary digits
-    int value = 0;
-    int bits_read = 0;
-
-    while ((c = parse_next_char(parser)) != LINEFEED) {
-        if (c == EOF) {
-            fprintf(stderr, "Unexpected end of file while parsing number at line %d\n",
-                    parser->line);
-            return 0;
-        }
-
-        if (c != SPACE && c != TAB) {
-            fprintf(stderr, "Invalid binary digit at line %d, col %d: expected space or tab, got '%c' (ASCII %d)\n",
-                    parser->line, parser->col, c, c);
-            return 0;
-        }
-
-        value <<= 1;
-        if (c == TAB) value |= 1;
-        bits_read++;
+    const int bits_read = parse_bits(parser);
+    if (bits_read == -1) {
+        interpreter_report(parser->owner, "Unexpected end of file while parsing number at line %d\n",
+                           parse_location(parser, NULL));
+        parser->warnings++;
+    }
+    if (bits_read < 0) {
+        return 0;
     }
 
+    const Value value = value_from_bits(NULL, sign, parser->label, bits_read);
+
 #ifdef DEBUG
-    printf("DEBUG: bits_read=%d, value=%d, sign=%d, result=%d\n",
-           bits_read, value, sign, sign * (bits_read == 0 ? 0 : value));
+    printf("DEBUG: bits_read=%d, sign=%d, result=", bits_read, sign);
+    value_fprint(stdout, value);
+    printf("\n");
 #endif
 
-    return (bits_read == 0) ? 0 : sign * value;
+    return value;
 }
 
+// Reads label bits into parser->label, returns their count or -1 on error
 int parse_label(ParserState *parser) {
-    int label = 0;
-    char c;
-
-    while ((c = parse_next_char(parser)) != LINEFEED) {
-        if (c == EOF) {
-            fprintf(stderr, "Unexpected end of file while parsing label at line %d\n",
-                    parser->line);
-            return -1;
-        }
-
-        if (c != SPACE && c != TAB) {
-            fprintf(stderr, "Invalid label character at line %d, col %d: '%c' (ASCII %d)\n",
-                    parser->line, parser->col, c, c);
-            return -1;
-        }
-
-        label <<= 1;
-        if (c == TAB) label |= 1;
+    const int length = parse_bits(parser);
+    if (length == -1) {
+        interpreter_report(parser->owner, "Unexpected end of file while parsing label at line %d\n",
+                           parse_location(parser, NULL));
     }
-
-    return label;
+    return length < 0 ? -1 : length;
 }
\ No newline at end of file
@@ -6,11 +6,10 @@
 #define INTERPRETER_H
 
 // Global options
-#define HEAP_SIZE 524228
-#define STACK_SIZE 65536
+#define STACK_SIZE (1 << 24)        // Most values on the stack
 #define BUF_SIZE 4096
-#define MAX_LABELS 1024
-#define CALL_STACK_SIZE 256
+#define CALL_STACK_SIZE (1 << 20)   // Deepest recursion
+#define FUEL_UNLIMITED INT64_MAX
 
 // Lexical tokens
 #define SPACE ' '
@@ -19,52 +18,109 @@
 #define NULL_TERM '\0'
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "labels.h"
+#include "value.h"
+#include "heap.h"
+#include "stream.h"
 
 typedef struct {
     char* source;       // Source file
     long long length;      // Length of source code
-    int position;       // Current position
-    int line;           // Current line on interp
-    int col;            // Same as line but with a column
+    size_t mapping_size;    // Nonzero if source maps the file (see source.c)
+    char* tokens;       // Space, tab and linefeed bytes of source, while decoding
+    int* offsets;       // Where each token sits in source, for diagnostics
+    int token_count;
+    int position;       // Current token
+    char* label;        // Bits of the last parsed label or number ('0'/'1')
+    int label_capacity;
+    int warnings;       // Diagnostics the decode went on after
+    struct Interpreter* owner;  // Whose error output diagnostics go to
 } ParserState;
 
 typedef struct {
-    int* data;
+    Value* data;        // Values, or raw return addresses on the call stack
     int top;
-    int capacity;
+    int capacity;       // Slots usable now
+    int maximum;        // Slots it may grow to (see st_reserve)
 } Stack;
 
+// One decoded instruction
 typedef struct {
-    int address;        // Address of the label (decimal)
-    int position;       // Position in the code
-} Label;
+    uint8_t opcode;     // Opcode (see instruction.h)
+    int operand;        // Number for push/copy/slide, constant index for push_const, target index for flow control
+} Op;
 
+// Program decoded once at load time
 typedef struct {
+    Op* code;           // Instructions, always terminated by an OP_END
+    int* lines;         // Source line of each instruction, filled in at the end of decoding (for diagnostics)
+    int length;
+    int capacity;
+    Value* constants;   // Pushed numbers too large for an operand
+    int constant_count;
+    int constant_capacity;
+    void* mapping;      // Cache file code and lines point into, NULL if they are allocated (see cache.h)
+    size_t mapping_size;
+} Program;
+
+typedef struct Interpreter {
     Stack* stack;       // Value stack
-    int *heap;          // Heap
-    Label* labels;      // Array of labels
-    int label_count;
+    Heap heap;          // Heap, paged in on first store
+    LabelTable labels;  // Labels by bit string
     Stack* call_stack;
-    bool running;
+    bool running;       // Cleared when the program stops
+    bool failed;        // It stopped on an error
     ParserState parser;
+    Program program;    // Decoded instructions
+    int pc;             // Index of the next instruction to execute
+    const Value* run_sp;    // Top slot of the value stack where the run from pc began, NULL while pc is exact (see guard.c)
+    int64_t fuel;       // Instructions left before interpreter_continue stops (see m_interpreter.c)
+    bool fuse;          // Fuse common sequences into superinstructions at load
+    int optimize;       // Optimizer level at load, 0 for none (see optimize.c)
+    BigPool bigs;       // Bignums created while running
+    Output output;      // Program output not yet written to stdout
+    Input input;        // Program input read ahead from stdin
+    bool jit;           // Run the program as native code where supported
+    struct JitCode* jit_code;   // Native code of program, built on first run
+    StreamWrite error_write;    // Load and runtime error messages, stderr by default
+    void* error_user;
 } Interpreter;
 
-Stack* st_new(int capacity);
+Stack* st_new(int maximum);
 void st_free(Stack *stack);
-bool st_push(Stack *stack, int value);
-int st_pop(Stack *stack);
-int st_peek(Stack *stack, int offset);
+bool st_reserve(Stack *stack, int count);
+bool st_push(Stack *stack, Value value);
+Value st_pop(Stack *stack);
+Value st_peek(Stack *stack, int offset);
 
 char parse_next_char(ParserState *parser);
 char parse_peek_char(ParserState *parser);
+int parse_tokens(ParserState *parser);
+int parse_location(const ParserState *parser, int *col);
+void parse_free_tokens(ParserState *parser);
 void parse_skip_ws(ParserState *parser);
-int parse_number(ParserState *parser);
+Value parse_number(ParserState *parser);
 int parse_label(ParserState *parser);
 
 Interpreter* interpreter_new(void);
 void interpreter_delete(Interpreter* interpreter);
 int interpreter_load_str(Interpreter* interpreter, const char* source);
+int interpreter_load(Interpreter* interpreter, const char* source, size_t length);
+void interpreter_reset(Interpreter* interpreter);
 int interpreter_read_from_file(Interpreter* interpreter, const char *source);
+int interpreter_read_source(Interpreter* interpreter, const char *source);
+uint64_t interpreter_source_hash(const Interpreter* interpreter);
+int interpreter_decode(Interpreter* interpreter);
+int interpreter_current_line(const Interpreter* interpreter);
+void interpreter_collect(Interpreter* interpreter);
+void interpreter_report(Interpreter* interpreter, const char* format, ...);
+void interpreter_error(Interpreter* interpreter, const char* format, ...);
 void interpreter_run(Interpreter* interpreter);
+void interpreter_continue(Interpreter* interpreter);
+uint64_t interpreter_step(Interpreter* interpreter, uint64_t budget);
+uint64_t interpreter_step_to_input(Interpreter* interpreter, uint64_t budget);
+void interpreter_run_threaded(Interpreter* interpreter);
 
 #endif //INTERPRETER_H
@@ -0,0 +1,18 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+#include "interpreter.h"
+
+// Native code of a decoded program (see jit_x64.c)
+typedef struct JitCode JitCode;
+
+bool jit_available(void);
+bool jit_run(Interpreter *interpreter);
+void jit_free(JitCode *jit);
+
+#endif //JIT_H
@@ -0,0 +1,642 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Baseline x86-64 JIT. Every slot of the decoded program becomes a short run
+// of native code, so labels are plain native addresses and flow control is
+// a direct jump. Like the threaded loop, only the common case is compiled
+// inline: I/O, bignums, absent heap pages and every error leave through a
+// per-slot stub into jit_slow, which runs the reference handler and resumes
+// at whatever slot it left in pc. Fused opcodes are compiled as their first
+// instruction; the slots after it still hold the originals.
+// Taken branches charge fuel and keep their target in pc as the threaded
+// loop does, and leave through the exit once fuel is used up.
+//
+// Register use (all callee saved, so calls into C keep them):
+//   r15  Interpreter*
+//   r12  top slot of the value stack (sp of t_interpreter.c)
+//   r13  stack->data
+//   r14  last slot a push may start from, sp >= r14 overflows
+//   rbx  heap->low.pages, the page table of low addresses
+//   rbp  call stack, holding slot indices like the interpreters
+// rax, rcx and rdx are scratch.
+
+// MAP_ANONYMOUS is not part of strict C/POSIX modes
+#define _DEFAULT_SOURCE
+
+#include "jit.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+#include "instruction.h"
+#include "fusion.h"
+#include "verify.h"
+#include "x64.h"
+#include "config.h"
+
+#ifdef _WIN32
+    #define ARG0 X64_RCX
+    #define ARG1 X64_RDX
+#else
+    #define ARG0 X64_RDI
+    #define ARG1 X64_RSI
+#endif
+
+#define R_INTERP X64_R15
+#define R_SP X64_R12
+#define R_DATA X64_R13
+#define R_LIMIT X64_R14
+#define R_PAGES X64_RBX
+#define R_CALLS X64_RBP
+
+// Saved registers plus the frame keep rsp 16 byte aligned at calls, and
+// leave the 32 bytes of shadow space Windows wants
+#define FRAME_SIZE 40
+
+// Operands above this always take the slow path, so displacements fit
+#define MAX_INLINE_DEPTH (1 << 20)
+
+typedef void (*JitEntry)(Interpreter *interpreter, intptr_t start);
+
+struct JitCode {
+    uint8_t *memory;
+    size_t size;
+    JitEntry entry;
+};
+
+typedef enum {
+    FIX_SLOT,                   // Native code of a slot
+    FIX_SLOW,                   // Slow stub of a slot
+    FIX_TABLE                   // Table of slot addresses
+} FixupKind;
+
+typedef struct {
+    size_t at;                  // Offset of a rel32 field
+    FixupKind kind;
+    int slot;
+} Fixup;
+
+typedef struct {
+    X64Buffer code;
+    const Program *program;
+    size_t *native;             // Offset of each slot's code
+    size_t *stub;               // Offset of each slot's slow stub, 0 if none
+    Fixup *fixups;
+    size_t fixup_count;
+    size_t fixup_capacity;
+    size_t resume;              // Reload registers and jump to slot rax
+    size_t slow;                // Common slow path, slot index in ARG1
+    size_t out_of_fuel;         // Spill sp and return to jit_run
+    int proven;                 // Values the slot being compiled may count on (verify.c)
+    bool failed;
+} Compiler;
+
+// Run slot `index` through its reference handler. Returns the slot to go on
+// with, or -1 once the program stopped
+static intptr_t jit_slow(Interpreter *interpreter, const intptr_t index) {
+    const Op *op = &interpreter->program.code[index];
+    interpreter->fuel -= index + 1 - interpreter->pc;
+    interpreter->pc = (int)index + 1;
+    handler_table[op->opcode](interpreter, op->operand);
+    return interpreter->running ? interpreter->pc : -1;
+}
+
+static void add_fixup(Compiler *c, const size_t at, const FixupKind kind, const int slot) {
+    if (c->fixup_count == c->fixup_capacity) {
+        const size_t capacity = c->fixup_capacity ? c->fixup_capacity * 2 : 256;
+        Fixup *fixups = realloc(c->fixups, capacity * sizeof(Fixup));
+        if (fixups == NULL) {
+            c->failed = true;
+            return;
+        }
+        c->fixups = fixups;
+        c->fixup_capacity = capacity;
+    }
+    c->fixups[c->fixup_count++] = (Fixup){at, kind, slot};
+}
+
+static void jump_back(Compiler *c, const size_t target) {
+    const size_t at = x64_jmp(&c->code);
+    x64_patch_rel32(&c->code, at, target);
+}
+
+static void slow_if(Compiler *c, const X64Cond cond, const int slot) {
+    add_fixup(c, x64_jcc(&c->code, cond), FIX_SLOW, slot);
+}
+
+static void slow_always(Compiler *c, const int slot) {
+    add_fixup(c, x64_jmp(&c->code), FIX_SLOW, slot);
+}
+
+static void jump_to(Compiler *c, const int target) {
+    add_fixup(c, x64_jmp(&c->code), FIX_SLOT, target);
+}
+
+// Charge the run that ends with the branch in `slot` to fuel, then set pc
+// to the target in `target` (32 bits) and run_sp to sp. Uses rax and rcx;
+// leaves through the exit if fuel went negative
+static void charge(Compiler *c, const int slot, const X64Reg target) {
+    X64Buffer *b = &c->code;
+    x64_mov_rm(b, X64_RCX, x64_mem(R_INTERP, offsetof(Interpreter, fuel)));
+    x64_movsxd_rm(b, X64_RAX, x64_mem(R_INTERP, offsetof(Interpreter, pc)));
+    x64_alu_rr(b, X64_ADD, X64_RCX, X64_RAX);
+    x64_alu_ri(b, X64_SUB, X64_RCX, slot + 1);
+    // Moves keep the sign flag of the subtraction
+    x64_mov_mr(b, x64_mem(R_INTERP, offsetof(Interpreter, fuel)), X64_RCX);
+    x64_mov32_mr(b, x64_mem(R_INTERP, offsetof(Interpreter, pc)), target);
+    x64_mov_mr(b, x64_mem(R_INTERP, offsetof(Interpreter, run_sp)), R_SP);
+    x64_patch_rel32(b, x64_jcc(b, X64_CC_S), c->out_of_fuel);
+}
+
+// Taken branch from `slot` to the slot `target`
+static void branch_to(Compiler *c, const int slot, const int target) {
+    x64_mov_ri(&c->code, X64_RDX, target);
+    charge(c, slot, X64_RDX);
+    jump_to(c, target);
+}
+
+static void branch_to_if(Compiler *c, const X64Cond cond, const int slot, const int target) {
+    // Condition codes come in pairs, the low bit negates
+    const size_t skip = x64_jcc(&c->code, (X64Cond)(cond ^ 1));
+    branch_to(c, slot, target);
+    x64_patch_rel32(&c->code, skip, c->code.length);
+}
+
+// Jump to the slot whose index is in `index`
+static void dispatch(Compiler *c, const X64Reg index) {
+    add_fixup(c, x64_lea_rip(&c->code, X64_RCX), FIX_TABLE, 0);
+    x64_jmp_m(&c->code, x64_mem_index(X64_RCX, index, 8, 0));
+}
+
+// At least `depth` values on the stack
+static void need_depth(Compiler *c, const int depth, const int slot) {
+    if (depth <= c->proven) return;
+
+    if (depth == 1) {
+        x64_alu_rr(&c->code, X64_CMP, R_SP, R_DATA);
+    } else {
+        x64_lea(&c->code, X64_RAX, x64_mem(R_DATA, (depth - 1) * 8));
+        x64_alu_rr(&c->code, X64_CMP, R_SP, X64_RAX);
+    }
+    slow_if(c, X64_CC_B, slot);
+}
+
+// Room for one more value. With WS_STACK_GUARD a push past the end faults
+// on the guard page instead (guard.c)
+static void need_room(Compiler *c, const int slot) {
+#if WS_STACK_GUARD
+    (void)c;
+    (void)slot;
+#else
+    x64_alu_rr(&c->code, X64_CMP, R_SP, R_LIMIT);
+    slow_if(c, X64_CC_AE, slot);
+#endif
+}
+
+static void need_small(Compiler *c, const X64Reg reg, const int slot) {
+    x64_test_ri(&c->code, reg, 1);
+    slow_if(c, X64_CC_NE, slot);
+}
+
+// Push rax, room already checked
+static void push_rax(Compiler *c) {
+    x64_mov_mr(&c->code, x64_mem(R_SP, 8), X64_RAX);
+    x64_alu_ri(&c->code, X64_ADD, R_SP, 8);
+}
+
+// Replace the two top values by rax
+static void replace_two(Compiler *c, const X64Reg result) {
+    x64_alu_ri(&c->code, X64_SUB, R_SP, 8);
+    x64_mov_mr(&c->code, x64_mem(R_SP, 0), result);
+}
+
+// rax = NOS, rcx = TOS, both small
+static void load_small_pair(Compiler *c, const int slot) {
+    need_depth(c, 2, slot);
+    x64_mov_rm(&c->code, X64_RAX, x64_mem(R_SP, -8));
+    x64_mov_rm(&c->code, X64_RCX, x64_mem(R_SP, 0));
+    x64_mov_rr(&c->code, X64_RDX, X64_RAX);
+    x64_alu_rr(&c->code, X64_OR, X64_RDX, X64_RCX);
+    need_small(c, X64_RDX, slot);
+}
+
+// Heap cell of the tagged address in rax as [rcx + rax * 8]. Only pages of
+// the inline low table are reached, anything else is left to heap.c
+static void heap_cell(Compiler *c, const int slot) {
+    need_small(c, X64_RAX, slot);
+    x64_alu_ri(&c->code, X64_CMP, X64_RAX, (int32_t)(HEAP_TABLE_SPAN << 1));
+    slow_if(c, X64_CC_AE, slot);
+    x64_shift_ri(&c->code, X64_SAR, X64_RAX, 1);
+    x64_mov_rr(&c->code, X64_RCX, X64_RAX);
+    x64_shift_ri(&c->code, X64_SHR, X64_RCX, HEAP_PAGE_BITS);
+    x64_mov_rm(&c->code, X64_RCX, x64_mem_index(R_PAGES, X64_RCX, 8, 0));
+    x64_test_rr(&c->code, X64_RCX, X64_RCX);
+    slow_if(c, X64_CC_E, slot);
+    x64_alu_ri(&c->code, X64_AND, X64_RAX, (int32_t)(HEAP_PAGE_SIZE - 1));
+}
+
+static void compile_slot(Compiler *c, const int i) {
+    X64Buffer *b = &c->code;
+    const Op *op = &c->program->code[i];
+    const int operand = op->operand;
+    c->proven = verify_depth(op);
+
+    switch (fusion_first(op->opcode)) {
+        case OP_PUSH:
+        case OP_PUSH_CONST: {
+            const int64_t value = op->opcode == OP_PUSH_CONST
+                ? (int64_t)c->program->constants[operand]
+                : (int64_t)value_from_small(operand);
+            need_room(c, i);
+            if (value >= INT32_MIN && value <= INT32_MAX) {
+                x64_mov_mi(b, x64_mem(R_SP, 8), (int32_t)value);
+                x64_alu_ri(b, X64_ADD, R_SP, 8);
+            } else {
+                x64_mov_ri(b, X64_RAX, value);
+                push_rax(c);
+            }
+            break;
+        }
+
+        case OP_COPY:
+            if (operand < 0 || operand > MAX_INLINE_DEPTH) {
+                slow_always(c, i);
+                break;
+            }
+            need_depth(c, operand + 1, i);
+            need_room(c, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, -operand * 8));
+            push_rax(c);
+            break;
+
+        case OP_SLIDE:
+            if (operand < 0 || operand > MAX_INLINE_DEPTH) {
+                slow_always(c, i);
+                break;
+            }
+            need_depth(c, operand + 1, i);
+            if (operand > 0) {
+                x64_mov_rm(b, X64_RAX, x64_mem(R_SP, 0));
+                x64_alu_ri(b, X64_SUB, R_SP, operand * 8);
+                x64_mov_mr(b, x64_mem(R_SP, 0), X64_RAX);
+            }
+            break;
+
+        case OP_DUP:
+            need_depth(c, 1, i);
+            need_room(c, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, 0));
+            push_rax(c);
+            break;
+
+        case OP_SWAP:
+            need_depth(c, 2, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, 0));
+            x64_mov_rm(b, X64_RCX, x64_mem(R_SP, -8));
+            x64_mov_mr(b, x64_mem(R_SP, 0), X64_RCX);
+            x64_mov_mr(b, x64_mem(R_SP, -8), X64_RAX);
+            break;
+
+        case OP_DISCARD:
+            need_depth(c, 1, i);
+            x64_alu_ri(b, X64_SUB, R_SP, 8);
+            break;
+
+        // Tagged arithmetic as in t_interpreter.c, overflow goes slow
+
+        case OP_ADD:
+        case OP_SUB:
+            load_small_pair(c, i);
+            x64_alu_rr(b, fusion_first(op->opcode) == OP_ADD ? X64_ADD : X64_SUB, X64_RAX, X64_RCX);
+            slow_if(c, X64_CC_O, i);
+            replace_two(c, X64_RAX);
+            break;
+
+        case OP_MUL:
+            load_small_pair(c, i);
+            x64_shift_ri(b, X64_SAR, X64_RAX, 1);
+            x64_imul_rr(b, X64_RAX, X64_RCX);
+            slow_if(c, X64_CC_O, i);
+            replace_two(c, X64_RAX);
+            break;
+
+        case OP_DIV:
+        case OP_MOD:
+            // Zero goes slow for the error
+            load_small_pair(c, i);
+            x64_test_rr(b, X64_RCX, X64_RCX);
+            slow_if(c, X64_CC_E, i);
+            if (fusion_first(op->opcode) == OP_DIV) {
+                // Only SMALL_MIN / -1 leaves the small range
+                x64_alu_ri(b, X64_CMP, X64_RCX, (int32_t)value_from_small(-1));
+                slow_if(c, X64_CC_E, i);
+                x64_shift_ri(b, X64_SAR, X64_RAX, 1);
+                x64_shift_ri(b, X64_SAR, X64_RCX, 1);
+                x64_cqo(b);
+                x64_idiv_r(b, X64_RCX);
+                x64_alu_rr(b, X64_ADD, X64_RAX, X64_RAX);
+                replace_two(c, X64_RAX);
+            } else {
+                x64_cqo(b);
+                x64_idiv_r(b, X64_RCX);
+                replace_two(c, X64_RDX);
+            }
+            break;
+
+        case OP_STORE:
+            need_depth(c, 2, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, -8));
+            heap_cell(c, i);
+            x64_mov_rm(b, X64_RDX, x64_mem(R_SP, 0));
+            x64_mov_mr(b, x64_mem_index(X64_RCX, X64_RAX, 8, 0), X64_RDX);
+            x64_alu_ri(b, X64_SUB, R_SP, 16);
+            break;
+
+        case OP_RETRIEVE:
+            need_depth(c, 1, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, 0));
+            heap_cell(c, i);
+            x64_mov_rm(b, X64_RDX, x64_mem_index(X64_RCX, X64_RAX, 8, 0));
+            x64_mov_mr(b, x64_mem(R_SP, 0), X64_RDX);
+            break;
+
+        case OP_CALL:
+            if (operand < 0) {
+                slow_always(c, i);
+                break;
+            }
+            x64_movsxd_rm(b, X64_RAX, x64_mem(R_CALLS, offsetof(Stack, top)));
+            x64_alu_ri(b, X64_ADD, X64_RAX, 1);
+#if !WS_STACK_GUARD
+            x64_movsxd_rm(b, X64_RCX, x64_mem(R_CALLS, offsetof(Stack, capacity)));
+            x64_alu_rr(b, X64_CMP, X64_RAX, X64_RCX);
+            slow_if(c, X64_CC_GE, i);
+#endif
+            x64_mov32_mr(b, x64_mem(R_CALLS, offsetof(Stack, top)), X64_RAX);
+            x64_mov_rm(b, X64_RCX, x64_mem(R_CALLS, offsetof(Stack, data)));
+            x64_mov_mi(b, x64_mem_index(X64_RCX, X64_RAX, 8, 0), i + 1);
+            branch_to(c, i, operand);
+            break;
+
+        case OP_JUMP:
+            if (operand < 0) slow_always(c, i);
+            else branch_to(c, i, operand);
+            break;
+
+        case OP_JZ:
+            if (operand < 0) {
+                slow_always(c, i);
+                break;
+            }
+            need_depth(c, 1, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, 0));
+            x64_alu_ri(b, X64_SUB, R_SP, 8);
+            x64_test_rr(b, X64_RAX, X64_RAX);
+            branch_to_if(c, X64_CC_E, i, operand);
+            break;
+
+        case OP_JN:
+            if (operand < 0) {
+                slow_always(c, i);
+                break;
+            }
+            need_depth(c, 1, i);
+            x64_mov_rm(b, X64_RAX, x64_mem(R_SP, 0));
+            need_small(c, X64_RAX, i);
+            x64_alu_ri(b, X64_SUB, R_SP, 8);
+            x64_test_rr(b, X64_RAX, X64_RAX);
+            branch_to_if(c, X64_CC_S, i, operand);
+            break;
+
+        case OP_RET:
+            x64_movsxd_rm(b, X64_RAX, x64_mem(R_CALLS, offsetof(Stack, top)));
+            x64_test_rr(b, X64_RAX, X64_RAX);
+            slow_if(c, X64_CC_S, i);
+            x64_mov_rm(b, X64_RCX, x64_mem(R_CALLS, offsetof(Stack, data)));
+            x64_mov_rm(b, X64_RDX, x64_mem_index(X64_RCX, X64_RAX, 8, 0));
+            x64_alu_ri(b, X64_SUB, X64_RAX, 1);
+            x64_mov32_mr(b, x64_mem(R_CALLS, offsetof(Stack, top)), X64_RAX);
+            charge(c, i, X64_RDX);
+            dispatch(c, X64_RDX);
+            break;
+
+        default:
+            // I/O and end
+            slow_always(c, i);
+            break;
+    }
+}
+
+// stack->top from sp
+static void spill_sp(Compiler *c) {
+    X64Buffer *b = &c->code;
+    x64_mov_rm(b, X64_RAX, x64_mem(R_INTERP, offsetof(Interpreter, stack)));
+    x64_mov_rr(b, X64_RCX, R_SP);
+    x64_alu_rr(b, X64_SUB, X64_RCX, R_DATA);
+    x64_shift_ri(b, X64_SAR, X64_RCX, 3);
+    x64_mov32_mr(b, x64_mem(X64_RAX, offsetof(Stack, top)), X64_RCX);
+}
+
+// Entry, exit, register reload and the common slow path
+static void compile_runtime(Compiler *c) {
+    X64Buffer *b = &c->code;
+    static const X64Reg saved[] = {X64_RBX, X64_RBP, X64_R12, X64_R13, X64_R14, X64_R15};
+    const int saved_count = (int)(sizeof(saved) / sizeof(saved[0]));
+
+    // entry(interpreter, start)
+    for (int k = 0; k < saved_count; k++) x64_push_r(b, saved[k]);
+    x64_alu_ri(b, X64_SUB, X64_RSP, FRAME_SIZE);
+    x64_mov_rr(b, R_INTERP, ARG0);
+    x64_mov_rr(b, X64_RAX, ARG1);
+    x64_mov_rm(b, R_CALLS, x64_mem(R_INTERP, offsetof(Interpreter, call_stack)));
+    x64_lea(b, R_PAGES, x64_mem(R_INTERP, offsetof(Interpreter, heap) + offsetof(Heap, low)));
+
+    // Handlers may move the stack, so everything is reloaded after them
+    c->resume = b->length;
+    x64_mov_rm(b, X64_RCX, x64_mem(R_INTERP, offsetof(Interpreter, stack)));
+    x64_mov_rm(b, R_DATA, x64_mem(X64_RCX, offsetof(Stack, data)));
+    x64_movsxd_rm(b, X64_RDX, x64_mem(X64_RCX, offsetof(Stack, top)));
+    x64_lea(b, R_SP, x64_mem_index(R_DATA, X64_RDX, 8, 0));
+    x64_movsxd_rm(b, X64_RDX, x64_mem(X64_RCX, offsetof(Stack, capacity)));
+    x64_lea(b, R_LIMIT, x64_mem_index(R_DATA, X64_RDX, 8, -8));
+    x64_mov_mr(b, x64_mem(R_INTERP, offsetof(Interpreter, run_sp)), R_SP);
+    dispatch(c, X64_RAX);
+
+    c->out_of_fuel = b->length;
+    spill_sp(c);
+
+    const size_t exit = b->length;
+    x64_alu_ri(b, X64_ADD, X64_RSP, FRAME_SIZE);
+    for (int k = saved_count - 1; k >= 0; k--) x64_pop_r(b, saved[k]);
+    x64_ret(b);
+
+    // Spill sp, run the slot in C, then resume or leave
+    c->slow = b->length;
+    spill_sp(c);
+    x64_mov_rr(b, ARG0, R_INTERP);
+    x64_mov_ri(b, X64_RAX, (int64_t)(intptr_t)jit_slow);
+    x64_call_r(b, X64_RAX);
+    x64_test_rr(b, X64_RAX, X64_RAX);
+    const size_t stopped = x64_jcc(b, X64_CC_S);
+    x64_patch_rel32(b, stopped, exit);
+    jump_back(c, c->resume);
+}
+
+static void* alloc_writable(const size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    return memory == MAP_FAILED ? NULL : memory;
+#endif
+}
+
+static bool make_executable(void *memory, const size_t size) {
+#ifdef _WIN32
+    DWORD old;
+    return VirtualProtect(memory, size, PAGE_EXECUTE_READ, &old) != 0;
+#else
+    return mprotect(memory, size, PROT_READ | PROT_EXEC) == 0;
+#endif
+}
+
+static void release(void *memory, const size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
+
+// Copy the code and its slot table into executable memory
+static JitCode* install(Compiler *c) {
+    const int length = c->program->length;
+    const size_t table = (c->code.length + 7) & ~(size_t)7;
+    const size_t size = table + (size_t)length * sizeof(uint64_t);
+
+    JitCode *jit = malloc(sizeof(JitCode));
+    if (jit == NULL) return NULL;
+
+    jit->memory = alloc_writable(size);
+    if (jit->memory == NULL) {
+        free(jit);
+        return NULL;
+    }
+    jit->size = size;
+
+    memcpy(jit->memory, c->code.bytes, c->code.length);
+    for (int i = 0; i < length; i++) {
+        const uint64_t address = (uint64_t)(uintptr_t)(jit->memory + c->native[i]);
+        memcpy(jit->memory + table + (size_t)i * sizeof(uint64_t), &address, sizeof(address));
+    }
+
+    // The table sits right after the code; the rel32 fields were left for now
+    for (size_t k = 0; k < c->fixup_count; k++) {
+        if (c->fixups[k].kind != FIX_TABLE) continue;
+        const int32_t rel = (int32_t)((int64_t)table - (int64_t)(c->fixups[k].at + 4));
+        memcpy(jit->memory + c->fixups[k].at, &rel, sizeof(rel));
+    }
+
+    if (!make_executable(jit->memory, size)) {
+        release(jit->memory, size);
+        free(jit);
+        return NULL;
+    }
+
+    jit->entry = (JitEntry)(void *)jit->memory;
+    return jit;
+}
+
+static JitCode* jit_compile(const Program *program) {
+    const int length = program->length;
+    Compiler c = {0};
+    x64_init(&c.code);
+    c.program = program;
+    c.native = malloc((size_t)length * sizeof(size_t));
+    c.stub = calloc((size_t)length, sizeof(size_t));
+
+    JitCode *jit = NULL;
+    if (c.native == NULL || c.stub == NULL) goto done;
+
+    compile_runtime(&c);
+    for (int i = 0; i < length; i++) {
+        c.native[i] = c.code.length;
+        compile_slot(&c, i);
+    }
+
+    // Slow stubs, out of the way of the inline code
+    for (size_t k = 0; k < c.fixup_count; k++) {
+        const Fixup *fixup = &c.fixups[k];
+        if (fixup->kind != FIX_SLOW || c.stub[fixup->slot] != 0) continue;
+
+        c.stub[fixup->slot] = c.code.length;
+        x64_mov_ri(&c.code, ARG1, fixup->slot);
+        jump_back(&c, c.slow);
+    }
+
+    for (size_t k = 0; k < c.fixup_count; k++) {
+        const Fixup *fixup = &c.fixups[k];
+        if (fixup->kind == FIX_SLOT) x64_patch_rel32(&c.code, fixup->at, c.native[fixup->slot]);
+        else if (fixup->kind == FIX_SLOW) x64_patch_rel32(&c.code, fixup->at, c.stub[fixup->slot]);
+    }
+
+    if (!c.failed && !c.code.failed) jit = install(&c);
+
+done:
+    x64_free(&c.code);
+    free(c.native);
+    free(c.stub);
+    free(c.fixups);
+    return jit;
+}
+
+bool jit_available(void) {
+    return true;
+}
+
+// Run the program natively from interpreter->pc. False if it could not be
+// compiled, the caller then falls back to the interpreter
+bool jit_run(Interpreter *interpreter) {
+    if (interpreter->jit_code == NULL) {
+        interpreter->jit_code = jit_compile(&interpreter->program);
+        if (interpreter->jit_code == NULL) return false;
+    }
+
+    // Returns once the program stopped or fuel ran out
+    interpreter->jit_code->entry(interpreter, interpreter->pc);
+    return true;
+}
+
+void jit_free(JitCode *jit) {
+    if (jit == NULL) return;
+
+    release(jit->memory, jit->size);
+    free(jit);
+}
+
+#else
+
+bool jit_available(void) {
+    return false;
+}
+
+bool jit_run(Interpreter *interpreter) {
+    (void)interpreter;
+    return false;
+}
+
+void jit_free(JitCode *jit) {
+    (void)jit;
+}
+
+#endif
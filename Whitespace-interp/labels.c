@@ -0,0 +1,102 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#include "labels.h"
+#include <stdlib.h>
+#include <string.h>
+
+// FNV-1a over the label bits
+static uint32_t lt_hash(const char *name, const int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void lt_init(LabelTable *table) {
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->index = NULL;
+    table->index_size = 0;
+}
+
+void lt_free(LabelTable *table) {
+    for (int i = 0; i < table->count; i++) {
+        free(table->entries[i].name);
+    }
+    free(table->entries);
+    free(table->index);
+    lt_init(table);
+}
+
+static int lt_slot(const LabelTable *table, const char *name, const int length, const uint32_t hash) {
+    const int mask = table->index_size - 1;
+    int slot = (int)(hash & mask);
+
+    while (table->index[slot] != 0) {
+        const Label *label = &table->entries[table->index[slot] - 1];
+        if (label->hash == hash && label->length == length &&
+            memcmp(label->name, name, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+// Keep the load factor under 1/2
+static int lt_grow_index(LabelTable *table) {
+    const int size = table->index_size ? table->index_size * 2 : 64;
+    int *index = calloc(size, sizeof(int));
+    if (index == NULL) return -1;
+
+    free(table->index);
+    table->index = index;
+    table->index_size = size;
+
+    for (int i = 0; i < table->count; i++) {
+        const Label *label = &table->entries[i];
+        const int slot = lt_slot(table, label->name, label->length, label->hash);
+        table->index[slot] = i + 1;
+    }
+
+    return 0;
+}
+
+// Returns the id of the label, adding it if needed, -1 if out of memory
+int lt_intern(LabelTable *table, const char *name, const int length) {
+    if ((table->count + 1) * 2 > table->index_size && lt_grow_index(table) != 0) {
+        return -1;
+    }
+
+    const uint32_t hash = lt_hash(name, length);
+    const int slot = lt_slot(table, name, length, hash);
+    if (table->index[slot] != 0) {
+        return table->index[slot] - 1;
+    }
+
+    if (table->count >= table->capacity) {
+        const int capacity = table->capacity ? table->capacity * 2 : 64;
+        Label *entries = realloc(table->entries, capacity * sizeof(Label));
+        if (entries == NULL) return -1;
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+
+    Label *label = &table->entries[table->count];
+    label->name = malloc(length + 1);
+    if (label->name == NULL) return -1;
+    memcpy(label->name, name, length);
+    label->name[length] = '\0';
+    label->length = length;
+    label->hash = hash;
+    label->position = -1;
+
+    table->index[slot] = table->count + 1;
+    return table->count++;
+}
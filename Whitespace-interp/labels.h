@@ -0,0 +1,30 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef LABELS_H
+#define LABELS_H
+
+#include <stdint.h>
+
+typedef struct {
+    char* name;         // Label bits as '0'/'1' characters, null terminated
+    int length;         // Number of bits
+    uint32_t hash;
+    int position;       // Index of the instruction that follows the mark, -1 if never marked
+} Label;
+
+// Labels keyed on their full bit string, no fixed limit
+typedef struct {
+    Label* entries;     // Labels in order of first appearance, index is the label id
+    int count;
+    int capacity;
+    int* index;         // Open addressing slots holding id + 1, 0 when empty
+    int index_size;     // Power of two
+} LabelTable;
+
+void lt_init(LabelTable *table);
+void lt_free(LabelTable *table);
+int lt_intern(LabelTable *table, const char *name, int length);
+
+#endif //LABELS_H
@@ -1,274 +1,424 @@
 //
 // Created by IWOFLEUR on 26.01.2026.
 //
+#include <errno.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "interpreter.h"
 #include "instruction.h"
+#include "fusion.h"
+#include "optimize.h"
+#include "verify.h"
+#include "jit.h"
+#include "cache.h"
+#include "guard.h"
 #include "config.h"
 
-#define INSTR_COUNT (sizeof(instruction_table) / sizeof(instruction_table[0]))
+// Pseudo opcode for label marks: resolved by the decoder, never emitted
+#define OP_MARK OP_COUNT
+
+typedef enum {
+    PARAM_NONE,
+    PARAM_NUMBER,
+    PARAM_LABEL
+} ParamKind;
+
+// Signature characters as base 3 digits. A signature read so far is a node
+// of the decoding trie, numbered by its digits after a leading 1, so the
+// child for the next character is node * 3 + digit and no two prefixes
+// share a number. Signatures are at most SIGNATURE_MAX characters
+#define SIG_S 0
+#define SIG_T 1
+#define SIG_L 2
+#define SIGNATURE_MAX 4
+#define DECODE_NODES 243        // 3^(SIGNATURE_MAX + 1)
+
+#define SIG(a, b)        ((3 + SIG_##a) * 3 + SIG_##b)
+#define SIG3(a, b, c)    (SIG(a, b) * 3 + SIG_##c)
+#define SIG4(a, b, c, d) (SIG3(a, b, c) * 3 + SIG_##d)
+
+// The instruction set: signature node, signature length, opcode, parameter
+#define INSTRUCTIONS(X) \
+    /* STACK */ \
+    X(SIG(S, S),            2,  OP_PUSH,        PARAM_NUMBER) \
+    X(SIG3(S, T, S),        3,  OP_COPY,        PARAM_NUMBER) \
+    X(SIG3(S, T, L),        3,  OP_SLIDE,       PARAM_NUMBER) \
+    X(SIG3(S, L, S),        3,  OP_DUP,         PARAM_NONE) \
+    X(SIG3(S, L, T),        3,  OP_SWAP,        PARAM_NONE) \
+    X(SIG3(S, L, L),        3,  OP_DISCARD,     PARAM_NONE) \
+    /* ARITHMETIC */ \
+    X(SIG4(T, S, S, S),     4,  OP_ADD,         PARAM_NONE) \
+    X(SIG4(T, S, S, T),     4,  OP_SUB,         PARAM_NONE) \
+    X(SIG4(T, S, S, L),     4,  OP_MUL,         PARAM_NONE) \
+    X(SIG4(T, S, T, S),     4,  OP_DIV,         PARAM_NONE) \
+    X(SIG4(T, S, T, T),     4,  OP_MOD,         PARAM_NONE) \
+    /* HEAP */ \
+    X(SIG3(T, T, S),        3,  OP_STORE,       PARAM_NONE) \
+    X(SIG3(T, T, T),        3,  OP_RETRIEVE,    PARAM_NONE) \
+    /* I/O */ \
+    X(SIG4(T, L, S, S),     4,  OP_OUT_CHAR,    PARAM_NONE) \
+    X(SIG4(T, L, S, T),     4,  OP_OUT_NUM,     PARAM_NONE) \
+    X(SIG4(T, L, T, S),     4,  OP_IN_CHAR,     PARAM_NONE) \
+    X(SIG4(T, L, T, T),     4,  OP_IN_NUM,      PARAM_NONE) \
+    /* FLOW */ \
+    X(SIG3(L, S, S),        3,  OP_MARK,        PARAM_LABEL) \
+    X(SIG3(L, S, T),        3,  OP_CALL,        PARAM_LABEL) \
+    X(SIG3(L, S, L),        3,  OP_JUMP,        PARAM_LABEL) \
+    X(SIG3(L, T, S),        3,  OP_JZ,          PARAM_LABEL) \
+    X(SIG3(L, T, T),        3,  OP_JN,          PARAM_LABEL) \
+    X(SIG3(L, T, L),        3,  OP_RET,         PARAM_NONE) \
+    X(SIG3(L, L, L),        3,  OP_END,         PARAM_NONE)
 
 typedef struct {
-    uint8_t len;                        // length of signature
-    char sig[4];                        // SPACE / TAB / LINEFEED
-    void (*handler)(Interpreter*);
-    bool has_param;                     // Does this instruction have a parameter?
+    uint8_t len;                        // Length of signature, 0 if the node is not an instruction
+    uint8_t opcode;
+    ParamKind param;                    // Kind of parameter following the signature
 } Instruction;
 
-static const Instruction instruction_table[] = {
-    // STACK
-    {2, {SPACE,     SPACE},                             instr_push,             true},    // Push number
-    {3, {SPACE,     TAB,        SPACE},                 instr_copy,             true},    // Copy nth item (ADDED)
-    {3, {SPACE,     TAB,        LINEFEED},              instr_slide,            true},    // Slide n items (ADDED)
-    {3, {SPACE,     LINEFEED,   SPACE},                 instr_duplicate,        false},
-    {3, {SPACE,     LINEFEED,   TAB},                   instr_swap,             false},
-    {3, {SPACE,     LINEFEED,   LINEFEED},              instr_discard,          false},
-
-    // ARITHMETIC
-    {4, {TAB,       SPACE,      SPACE,      SPACE},     instr_add,              false},
-    {4, {TAB,       SPACE,      SPACE,      TAB},       instr_sub,              false},
-    {4, {TAB,       SPACE,      SPACE,      LINEFEED},  instr_mul,              false},
-    {4, {TAB,       SPACE,      TAB,        SPACE},     instr_div,              false},
-    {4, {TAB,       SPACE,      TAB,        TAB},       instr_mod,              false},
-
-    // HEAP
-    {3, {TAB,       TAB,        SPACE},                 instr_heap_store,       false},
-    {3, {TAB,       TAB,        TAB},                   instr_heap_retrieve,    false},
-
-    // I/O
-    {4, {TAB,       LINEFEED,   SPACE,      SPACE},     instr_out_char,         false},
-    {4, {TAB,       LINEFEED,   SPACE,      TAB},       instr_out_num,          false},
-    {4, {TAB,       LINEFEED,   TAB,        SPACE},     instr_in_char,          false},
-    {4, {TAB,       LINEFEED,   TAB,        TAB},       instr_in_num,           false},
-
-    // FLOW
-    {3, {LINEFEED,  SPACE,      SPACE},                 instr_mark,             true},    // Has label param
-    {3, {LINEFEED,  SPACE,      TAB},                   instr_call_subroutine,  true},
-    {3, {LINEFEED,  SPACE,      LINEFEED},              instr_jump,             true},
-    {3, {LINEFEED,  TAB,        SPACE},                 instr_jump_if_zero,     true},
-    {3, {LINEFEED,  TAB,        TAB},                   instr_jump_if_neg,      true},
-    {3, {LINEFEED,  TAB,        LINEFEED},              instr_ret,              false},
-    {3, {LINEFEED,  LINEFEED,   LINEFEED},              instr_end,              false},
+// Trie nodes that complete an instruction. Whitespace signatures are a
+// prefix code, so the first one reached is the match
+#define DECODE_ENTRY(node, length, op, kind) [node] = {length, op, kind},
+static const Instruction decode_table[DECODE_NODES] = {
+    INSTRUCTIONS(DECODE_ENTRY)
+};
+#undef DECODE_ENTRY
+
+// Handlers indexed by opcode
+void (*const handler_table[OP_COUNT])(Interpreter*, int) = {
+    [OP_PUSH]       = instr_push,
+    [OP_PUSH_CONST] = instr_push_const,
+    [OP_COPY]       = instr_copy,
+    [OP_SLIDE]      = instr_slide,
+    [OP_DUP]        = instr_duplicate,
+    [OP_SWAP]       = instr_swap,
+    [OP_DISCARD]    = instr_discard,
+    [OP_ADD]        = instr_add,
+    [OP_SUB]        = instr_sub,
+    [OP_MUL]        = instr_mul,
+    [OP_DIV]        = instr_div,
+    [OP_MOD]        = instr_mod,
+    [OP_STORE]      = instr_heap_store,
+    [OP_RETRIEVE]   = instr_heap_retrieve,
+    [OP_OUT_CHAR]   = instr_out_char,
+    [OP_OUT_NUM]    = instr_out_num,
+    [OP_IN_CHAR]    = instr_in_char,
+    [OP_IN_NUM]     = instr_in_num,
+    [OP_CALL]       = instr_call_subroutine,
+    [OP_JUMP]       = instr_jump,
+    [OP_JZ]         = instr_jump_if_zero,
+    [OP_JN]         = instr_jump_if_neg,
+    [OP_RET]        = instr_ret,
+    [OP_END]        = instr_end,
+
+    // Fused instructions run as their first instruction
+    [OP_PUSH_ADD]           = instr_push,
+    [OP_PUSH_SUB]           = instr_push,
+    [OP_PUSH_MUL]           = instr_push,
+    [OP_PUSH_STORE]         = instr_push,
+    [OP_PUSH_PUSH_STORE]    = instr_push,
+    [OP_PUSH_RETRIEVE]      = instr_push,
+    [OP_PUSH_OUT_CHAR]      = instr_push,
+    [OP_DUP_JZ]             = instr_duplicate,
+    [OP_DUP_JN]             = instr_duplicate,
+    [OP_SUB_JZ]             = instr_sub,
+    [OP_SWAP_SUB]           = instr_swap,
+    [OP_PUSH_SUB_DUP_JN]    = instr_push,
+
+    // Unchecked instructions run checked, the handlers are not the hot path
+    [OP_COPY_UNCHECKED]             = instr_copy,
+    [OP_SLIDE_UNCHECKED]            = instr_slide,
+    [OP_DUP_UNCHECKED]              = instr_duplicate,
+    [OP_SWAP_UNCHECKED]             = instr_swap,
+    [OP_DISCARD_UNCHECKED]          = instr_discard,
+    [OP_ADD_UNCHECKED]              = instr_add,
+    [OP_SUB_UNCHECKED]              = instr_sub,
+    [OP_MUL_UNCHECKED]              = instr_mul,
+    [OP_DIV_UNCHECKED]              = instr_div,
+    [OP_MOD_UNCHECKED]              = instr_mod,
+    [OP_STORE_UNCHECKED]            = instr_heap_store,
+    [OP_RETRIEVE_UNCHECKED]         = instr_heap_retrieve,
+    [OP_JZ_UNCHECKED]               = instr_jump_if_zero,
+    [OP_JN_UNCHECKED]               = instr_jump_if_neg,
+    [OP_PUSH_ADD_UNCHECKED]         = instr_push,
+    [OP_PUSH_SUB_UNCHECKED]         = instr_push,
+    [OP_PUSH_MUL_UNCHECKED]         = instr_push,
+    [OP_PUSH_STORE_UNCHECKED]       = instr_push,
+    [OP_DUP_JZ_UNCHECKED]           = instr_duplicate,
+    [OP_DUP_JN_UNCHECKED]           = instr_duplicate,
+    [OP_SUB_JZ_UNCHECKED]           = instr_sub,
+    [OP_SWAP_SUB_UNCHECKED]         = instr_swap,
+    [OP_PUSH_SUB_DUP_JN_UNCHECKED]  = instr_push,
 };
 
-// Helper to save/restore parser state
-typedef struct {
-    int position;
-    int line;
-    int col;
-} ParserStateBackup;
+// Append one instruction to the decoded program
+static int program_emit(Program *program, uint8_t opcode, int operand, int line) {
+    if (program->length >= program->capacity) {
+        int capacity = program->capacity ? program->capacity * 2 : 256;
 
-static ParserStateBackup save_parser_state(ParserState *p) {
-    return (ParserStateBackup){p->position, p->line, p->col};
-}
+        Op *code = realloc(program->code, capacity * sizeof(Op));
+        if (code == NULL) return -1;
+        program->code = code;
 
-static void restore_parser_state(ParserState *p, ParserStateBackup backup) {
-    p->position = backup.position;
-    p->line = backup.line;
-    p->col = backup.col;
-}
+        int *lines = realloc(program->lines, capacity * sizeof(int));
+        if (lines == NULL) return -1;
+        program->lines = lines;
 
-bool exec_instruction(Interpreter *interpreter) {
-    ParserState *p = &interpreter->parser;
+        program->capacity = capacity;
+    }
 
-    // Save starting position in case we need to backtrack
-    ParserStateBackup start_state = save_parser_state(p);
+    program->code[program->length].opcode = opcode;
+    program->code[program->length].operand = operand;
+    program->lines[program->length] = line;
+    program->length++;
+    return 0;
+}
 
-    // Read first meaningful character (skip comments)
-    char first;
-    do {
-        first = parse_next_char(p);
-        if (first == EOF) return false;
-    } while (first != SPACE && first != TAB && first != LINEFEED);
-
-    // Try each instruction that starts with this character
-    for (size_t i = 0; i < INSTR_COUNT; i++) {
-        const Instruction *ins = &instruction_table[i];
-
-        if (ins->sig[0] != first) continue;
-
-        // Restore to after first character
-        restore_parser_state(p, start_state);
-        parse_next_char(p);  // Re-read first char
-
-        // Try to match the full signature
-        bool match = true;
-        for (int j = 1; j < ins->len; j++) {
-            char c = parse_next_char(p);
-            if (c != ins->sig[j]) {
-                match = false;
-                break;
-            }
-        }
+// Keep a pushed number that does not fit an operand, returns its index
+static int program_add_constant(Program *program, const Value value) {
+    if (program->constant_count >= program->constant_capacity) {
+        int capacity = program->constant_capacity ? program->constant_capacity * 2 : 16;
 
-        if (match) {
-            // Success - execute the instruction
-            ins->handler(interpreter);
-            return interpreter->running;
-        }
+        Value *constants = realloc(program->constants, capacity * sizeof(Value));
+        if (constants == NULL) return -1;
+        program->constants = constants;
+        program->constant_capacity = capacity;
     }
 
-    // No instruction matched - restore and error
-    restore_parser_state(p, start_state);
+    program->constants[program->constant_count] = value;
+    return program->constant_count++;
+}
 
-    // Skip the problematic character so we don't loop
-    parse_next_char(p);
+// Numeric operand of a decoded instruction. Pushes of large numbers become
+// push_const; copy and slide counts saturate, no stack is that deep anyway
+static int decode_number(Program *program, uint8_t *opcode, const Value number) {
+    int operand;
+    if (value_to_int(number, &operand)) {
+        return operand;
+    }
 
-    fprintf(stderr, "Unknown instruction at line %d (char: ", p->line);
-    if (first == SPACE) fprintf(stderr, "SPACE");
-    else if (first == TAB) fprintf(stderr, "TAB");
-    else if (first == LINEFEED) fprintf(stderr, "LINEFEED");
-    else fprintf(stderr, "%c", first);
-    fprintf(stderr, ")\n");
+    if (*opcode == OP_PUSH) {
+        *opcode = OP_PUSH_CONST;
+        return program_add_constant(program, number);
+    }
 
-    interpreter->running = false;
-    return false;
+    operand = value_is_negative(number) ? INT_MIN : INT_MAX;
+    value_free_constant(number);
+    return operand;
 }
 
-void collect_labels(Interpreter* interpreter) {
-    // Save current parser state
-    ParserStateBackup saved_state = save_parser_state(&interpreter->parser);
+// Match the next instruction signature, reading each character once. NULL
+// if nothing matches, with the parser back after first
+static const Instruction* decode_signature(ParserState *p, const char first) {
+    const int position = p->position;
+
+    int node = 1;
+    char c = first;
+    for (int depth = 1; c != EOF; depth++) {
+        node = node * 3 + (c == SPACE ? SIG_S : c == TAB ? SIG_T : SIG_L);
+        if (decode_table[node].len != 0) return &decode_table[node];
+        if (depth == SIGNATURE_MAX) break;
+        c = parse_next_char(p);
+    }
 
-    // Reset to beginning
-    interpreter->parser.position = 0;
-    interpreter->parser.line = 1;
-    interpreter->parser.col = 1;
-    interpreter->label_count = 0;
+    p->position = position;
+    return NULL;
+}
 
-    // First pass: collect all labels
-    while (interpreter->parser.position < interpreter->parser.length) {
-        ParserStateBackup start_state = save_parser_state(&interpreter->parser);
+// Decoding leaves in lines where each instruction's first token ends in
+// the source; count the linefeeds up to there. Instructions are emitted in
+// source order, so it is one pass over the source however long the program
+static void locate_lines(Program *program, const char *source) {
+    int line = 1;
+    int start = 0;
+    for (int i = 0; i < program->length; i++) {
+        const int end = program->lines[i];
+        const char *found;
+        while ((found = memchr(source + start, LINEFEED, (size_t)(end - start))) != NULL) {
+            line++;
+            start = (int)(found - source) + 1;
+        }
+        start = end;
+        program->lines[i] = line;
+    }
+}
 
-        // Read first character
-        char first = parse_next_char(&interpreter->parser);
-        if (first == EOF) break;
+// Replace label ids in flow control operands by target indices
+static void resolve_labels(Interpreter *interpreter) {
+    Program *program = &interpreter->program;
 
-        // Skip non-whitespace (comments)
-        while (first != SPACE && first != TAB && first != LINEFEED && first != EOF) {
-            first = parse_next_char(&interpreter->parser);
+    for (int i = 0; i < program->length; i++) {
+        Op *op = &program->code[i];
+        if (op->opcode != OP_CALL && op->opcode != OP_JUMP &&
+            op->opcode != OP_JZ && op->opcode != OP_JN) {
+            continue;
         }
 
-        if (first == EOF) break;
+        const int position = interpreter->labels.entries[op->operand].position;
+        op->operand = position >= 0 ? position : -op->operand - 1;
+    }
+}
 
-        // Check if it's a label definition [L][S][S]
-        if (first == LINEFEED) {
-            ParserStateBackup before_second = save_parser_state(&interpreter->parser);
-            char second = parse_next_char(&interpreter->parser);
+// Translate the whole source into program once, resolving label marks
+int interpreter_decode(Interpreter *interpreter) {
+    ParserState *p = &interpreter->parser;
+    Program *program = &interpreter->program;
 
-            // Skip comments between LINEFEED and second char
-            while (second != SPACE && second != TAB && second != LINEFEED && second != EOF) {
-                second = parse_next_char(&interpreter->parser);
-            }
+    cache_release(program);
+    program->length = 0;
+    for (int i = 0; i < program->constant_count; i++) {
+        value_free_constant(program->constants[i]);
+    }
+    program->constant_count = 0;
+    lt_free(&interpreter->labels);
+    jit_free(interpreter->jit_code);
+    interpreter->jit_code = NULL;
+
+    p->warnings = 0;
+    if (parse_tokens(p) != 0) {
+        interpreter_report(interpreter, "Error reading source: %s\n", strerror(errno));
+        return -1;
+    }
 
-            if (second == SPACE) {
-                ParserStateBackup before_third = save_parser_state(&interpreter->parser);
-                char third = parse_next_char(&interpreter->parser);
-
-                // Skip comments
-                while (third != SPACE && third != TAB && third != LINEFEED && third != EOF) {
-                    third = parse_next_char(&interpreter->parser);
-                }
-
-                if (third == SPACE) {
-                    // Found a label definition [L][S][S]
-                    // Parse the label
-                    int label = parse_label(&interpreter->parser);
-                    if (label >= 0) {
-                        // Label position should be where execution continues
-                        // after parsing the entire label instruction
-                        fc_add_label(interpreter, label, interpreter->parser.position);
-                    }
-                    continue; // Continue to next instruction
-                } else {
-                    // Not a label, restore and skip this instruction
-                    restore_parser_state(&interpreter->parser, before_third);
-                }
-            } else {
-                // Not a label, restore and skip this instruction
-                restore_parser_state(&interpreter->parser, before_second);
-            }
+    char first;
+    while ((first = parse_next_char(p)) != EOF) {
+        const int end = p->offsets[p->position - 1] + 1;
+        const Instruction *ins = decode_signature(p, first);
+
+        if (ins == NULL) {
+            const char *name = first == SPACE ? "SPACE" : first == TAB ? "TAB" : "LINEFEED";
+            interpreter_report(interpreter, "Unknown instruction at line %d (char: %s)\n",
+                               parse_location(p, NULL), name);
+            return -1;
         }
 
-        // If not a label definition, skip this instruction
-        // Restore to start and use exec_instruction to skip
-        restore_parser_state(&interpreter->parser, start_state);
-
-        // Try to match and skip any instruction
-        bool skipped = false;
-        for (size_t i = 0; i < INSTR_COUNT; i++) {
-            const Instruction *ins = &instruction_table[i];
-
-            ParserStateBackup try_state = save_parser_state(&interpreter->parser);
-
-            // Try to match the signature
-            bool match = true;
-            for (int j = 0; j < ins->len; j++) {
-                char c = parse_next_char(&interpreter->parser);
-                if (c != ins->sig[j]) {
-                    match = false;
-                    break;
-                }
+        uint8_t opcode = ins->opcode;
+        int operand = 0;
+        if (ins->param == PARAM_NUMBER) {
+            operand = decode_number(program, &opcode, parse_number(p));
+            if (operand < 0 && opcode == OP_PUSH_CONST) {
+                interpreter_report(interpreter, "Error allocating memory: %s\n", strerror(errno));
+                return -1;
             }
-
-            if (match) {
-                // Skip parameter if instruction has one
-                if (ins->has_param) {
-                    if (ins->sig[0] == SPACE && ins->sig[1] == SPACE) {
-                        // Push - skip number
-                        parse_number(&interpreter->parser);
-                    } else if (ins->sig[0] == SPACE && ins->sig[1] == TAB) {
-                        // Copy or Slide - skip number
-                        parse_number(&interpreter->parser);
-                    } else if (ins->sig[0] == LINEFEED &&
-                               ins->sig[1] == SPACE &&
-                               ins->sig[2] != LINEFEED) {
-                        // Flow control with label - skip label
-                        parse_label(&interpreter->parser);
-                    } else if (ins->sig[0] == LINEFEED &&
-                               ins->sig[1] == TAB &&
-                               ins->sig[2] != LINEFEED) {
-                        // Jump if zero/negative - skip label
-                        parse_label(&interpreter->parser);
-                    }
-                }
-                skipped = true;
-                break;
-            } else {
-                restore_parser_state(&interpreter->parser, try_state);
+        } else if (ins->param == PARAM_LABEL) {
+            const int length = parse_label(p);
+            if (length < 0) return -1;
+
+            operand = lt_intern(&interpreter->labels, length ? p->label : "", length);
+            if (operand < 0) {
+                interpreter_report(interpreter, "Error allocating memory: %s\n", strerror(errno));
+                return -1;
             }
         }
 
-        if (!skipped) {
-            // Couldn't skip - move forward one char to avoid infinite loop
-            parse_next_char(&interpreter->parser);
+        if (opcode == OP_MARK) {
+            // Label points at the instruction emitted next, the last mark wins
+            interpreter->labels.entries[operand].position = program->length;
+            continue;
+        }
+
+        if (program_emit(program, opcode, operand, end) != 0) {
+            interpreter_report(interpreter, "Error allocating memory: %s\n", strerror(errno));
+            return -1;
         }
     }
 
-    // Restore original parser state
-    restore_parser_state(&interpreter->parser, saved_state);
+    // Running off the end of the source behaves like an explicit end
+    if (program_emit(program, OP_END, 0, (int)p->length) != 0) {
+        interpreter_report(interpreter, "Error allocating memory: %s\n", strerror(errno));
+        return -1;
+    }
+
+    parse_free_tokens(p);
+    locate_lines(program, p->source);
+
+    resolve_labels(interpreter);
+    optimize_program(interpreter);
+    if (interpreter->fuse) {
+        fuse_program(program);
+    }
+    verify_program(interpreter);
+    return 0;
 }
 
 void interpreter_run(Interpreter* interpreter) {
-    if (!interpreter->parser.source) {
+    if (interpreter->program.length == 0) {
         fprintf(stderr, "No instruction found\n");
         return;
     }
 
-    // First pass: collect all labels
-    collect_labels(interpreter);
-
-    // Second pass: execute
-    interpreter->parser.position = 0;
-    interpreter->parser.line = 1;
-    interpreter->parser.col = 1;
+    interpreter->pc = 0;
     interpreter->running = true;
+    interpreter->failed = false;
+    interpreter_continue(interpreter);
+}
 
-    while (interpreter->running &&
-           interpreter->parser.position < interpreter->parser.length) {
-        if (!exec_instruction(interpreter)) {
-            break;
-        }
+static void run_engine(Interpreter* interpreter, void* context) {
+    (void)context;
+    if (interpreter->jit && jit_run(interpreter)) return;
+
+#ifdef WS_ENGINE_CALL
+    const Op *code = interpreter->program.code;
+
+    while (interpreter->running) {
+        const int next = ++interpreter->pc;
+        const Op *op = &code[next - 1];
+        handler_table[op->opcode](interpreter, op->operand);
+        if (--interpreter->fuel < 0 && interpreter->pc != next) break;
+    }
+#else
+    interpreter_run_threaded(interpreter);
+#endif
+}
+
+// Carry on from pc until the program stops, or until it takes a branch
+// with its fuel used up. Every engine charges fuel one per instruction, but
+// only looks at it on taken branches, so it is a decrement per straight run
+// of code; running is still set when fuel stopped it, pc is where to go on
+void interpreter_continue(Interpreter* interpreter) {
+    guard_run(interpreter, run_engine, NULL);
+    output_flush(&interpreter->output);
+}
+
+typedef struct {
+    uint64_t budget;
+    uint64_t steps;
+    bool before_input;  // Stop at the first instruction that reads input
+} StepRun;
+
+static void run_steps(Interpreter* interpreter, void* context) {
+    StepRun *run = context;
+    const Op *code = interpreter->program.code;
+
+    while (interpreter->running && run->steps < run->budget) {
+        const Op *op = &code[interpreter->pc];
+        if (run->before_input && (op->opcode == OP_IN_CHAR || op->opcode == OP_IN_NUM)) break;
+
+        interpreter->pc++;
+        handler_table[op->opcode](interpreter, op->operand);
+        run->steps++;
     }
-}
\ No newline at end of file
+}
+
+static uint64_t step_run(Interpreter* interpreter, const uint64_t budget, const bool before_input) {
+    StepRun run = {budget, 0, before_input};
+    guard_run(interpreter, run_steps, &run);
+
+    output_flush(&interpreter->output);
+    return run.steps;
+}
+
+// Execute at most budget instructions from pc, one handler call each so
+// the count is exact. running is still set if the budget ran out first.
+// Returns the number of instructions executed
+uint64_t interpreter_step(Interpreter* interpreter, const uint64_t budget) {
+    return step_run(interpreter, budget, false);
+}
+
+// interpreter_step that stops with pc at an instruction reading input
+uint64_t interpreter_step_to_input(Interpreter* interpreter, const uint64_t budget) {
+    return step_run(interpreter, budget, true);
+}
@@ -1,18 +1,81 @@
 #include "interpreter.h"
+#include "fusion.h"
+#include "optimize.h"
+#include "verify.h"
+#include "jit.h"
+#include "emit.h"
+#include "batch.h"
+#include "checkpoint.h"
+#include "cache.h"
+#include "preeval.h"
+#include "profile.h"
+#include "sample.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// Requests a checkpoint and stops a run with --checkpoint
+#ifdef SIGUSR1
+    #define CHECKPOINT_SIGNAL SIGUSR1
+#else
+    #define CHECKPOINT_SIGNAL SIGBREAK
+#endif
+
+// Instructions between looks at the signal
+#define CHECKPOINT_SLICE 65536
+
+// Exit status after a checkpoint on CHECKPOINT_SIGNAL: the run is not
+// finished, resume it with --restore (EX_TEMPFAIL)
+#define EXIT_PREEMPTED 75
+
+// Instructions between looks at the clock with --max-time
+#define LIMIT_SLICE (1 << 22)
+
+// Exit status when --max-steps or --max-time stopped the program, as for
+// timeout(1)
+#define EXIT_LIMIT 124
+
+static volatile sig_atomic_t checkpoint_requested = 0;
 
 void print_version(void);
 void print_help(const char* program_name);
 void create_test_program(const char* filename);
 void create_simple_test_program(const char* filename);
 void dump_file(const char *filename);
+int emit_program(const Interpreter* interpreter, const char* path, const char* name);
+int list_program(const Interpreter* interpreter, const char* path, const char* name);
+int run_checkpointed(Interpreter* interpreter, const char* path, uint64_t every);
+int run_profiled(Interpreter* interpreter, const char* path, const char* name);
+int run_limited(Interpreter* interpreter, uint64_t max_steps, double max_time);
 
 int main(const int argc, char** argv) {
-    setvbuf(stdin, NULL, _IONBF, 0);
     setvbuf(stdout, NULL, _IONBF, 0);
 
     bool execute_directly = false;
+    bool fuse = true;
+    int optimize = 0;
+    bool fusion_stats = false;
+    bool heap_stats = false;
+    bool jit = false;
+    const char* emit_path = NULL;
+    const char* listing_path = NULL;
+    const char* batch_path = NULL;
+    int threads = 0;
+    const char* checkpoint_path = NULL;
+    const char* restore_path = NULL;
+    uint64_t checkpoint_every = 0;
+    bool cache = false;
+    const char* cache_path = NULL;
+    bool pre_eval = false;
+    const char* profile_path = NULL;
+    const char* sample_path = NULL;
+    uint64_t max_steps = 0;
+    double max_time = 0;
+    const char* flush = "auto";
     const char* filename = NULL;
     const char* direct_code = NULL;
 
@@ -20,11 +83,29 @@ int main(const int argc, char** argv) {
         {"help",    no_argument,        0, 'h'},
         {"execute", required_argument,  0, 'e'},
         {"version", no_argument,        0, 'v'},
+        {"no-fuse", no_argument,        0, 'F'},
+        {"fusion-stats", no_argument,   0, 'S'},
+        {"heap-stats", no_argument,     0, 'H'},
+        {"flush",   required_argument,  0, 'f'},
+        {"jit",     no_argument,        0, 'j'},
+        {"emit-c",  required_argument,  0, 'c'},
+        {"listing", required_argument,  0, 'L'},
+        {"batch",   required_argument,  0, 'b'},
+        {"threads", required_argument,  0, 't'},
+        {"checkpoint", required_argument,       0, 'k'},
+        {"checkpoint-every", required_argument, 0, 'K'},
+        {"restore", required_argument,          0, 'r'},
+        {"cache",   optional_argument,  0, 'C'},
+        {"pre-eval", no_argument,       0, 'E'},
+        {"profile", optional_argument,  0, 'P'},
+        {"sample",  optional_argument,  0, 's'},
+        {"max-steps", required_argument,   0, 'm'},
+        {"max-time",  required_argument,   0, 'T'},
         {0,         0,                  0,  0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "he:v", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "he:vO:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'h':
                 print_help(argv[0]);
@@ -39,6 +120,107 @@ int main(const int argc, char** argv) {
                 direct_code = optarg;
                 break;
 
+            case 'F':
+                fuse = false;
+                break;
+
+            case 'O': {
+                char* end;
+                const long level = strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || level < 0 || level > OPTIMIZE_MAX) {
+                    fprintf(stderr, "Error: -O expects a level from 0 to %d, got '%s'\n", OPTIMIZE_MAX, optarg);
+                    return 1;
+                }
+                optimize = (int)level;
+                break;
+            }
+
+            case 'S':
+                fusion_stats = true;
+                break;
+
+            case 'H':
+                heap_stats = true;
+                break;
+
+            case 'f':
+                flush = optarg;
+                break;
+
+            case 'j':
+                jit = true;
+                break;
+
+            case 'c':
+                emit_path = optarg;
+                break;
+
+            case 'L':
+                listing_path = optarg;
+                break;
+
+            case 'b':
+                batch_path = optarg;
+                break;
+
+            case 't':
+                threads = atoi(optarg);
+                if (threads <= 0) {
+                    fprintf(stderr, "Error: --threads expects a positive number, got '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 'k':
+                checkpoint_path = optarg;
+                break;
+
+            case 'K':
+                checkpoint_every = strtoull(optarg, NULL, 10);
+                if (checkpoint_every == 0) {
+                    fprintf(stderr, "Error: --checkpoint-every expects a positive number, got '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 'r':
+                restore_path = optarg;
+                break;
+
+            case 'C':
+                cache = true;
+                cache_path = optarg;
+                break;
+
+            case 'E':
+                cache = true;
+                pre_eval = true;
+                break;
+
+            case 'P':
+                profile_path = optarg ? optarg : "profile.json";
+                break;
+
+            case 's':
+                sample_path = optarg ? optarg : "sample.folded";
+                break;
+
+            case 'm':
+                max_steps = strtoull(optarg, NULL, 10);
+                if (max_steps == 0) {
+                    fprintf(stderr, "Error: --max-steps expects a positive number, got '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 'T':
+                max_time = strtod(optarg, NULL);
+                if (!(max_time > 0)) {
+                    fprintf(stderr, "Error: --max-time expects a positive number of seconds, got '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+
             default:
                 print_help(argv[0]);
                 return 1;
@@ -55,15 +237,56 @@ int main(const int argc, char** argv) {
         return 1;
     }
 
+    if (batch_path && (execute_directly || filename)) {
+        fprintf(stderr, "Error: Cannot specify both --batch and a program\n");
+        print_help(argv[0]);
+        return 1;
+    }
+
+    if (jit && !jit_available()) {
+        fprintf(stderr, "Warning: No JIT for this platform, interpreting instead\n");
+    }
+
+    if (batch_path) {
+        return batch_run(batch_path, threads, fuse, optimize, jit) == 0 ? 0 : 1;
+    }
+
     Interpreter* interpreter = interpreter_new();
     if (interpreter == NULL) {
         fprintf(stderr, "Error creating interpreter\n");
         return 1;
     }
+    interpreter->fuse = fuse;
+    interpreter->optimize = optimize;
+    interpreter->jit = jit;
+
+    // auto: line buffered on a terminal, block buffered into files and pipes
+    if (strcmp(flush, "full") == 0) {
+        interpreter->output.policy = FLUSH_FULL;
+    } else if (strcmp(flush, "line") == 0) {
+        interpreter->output.policy = FLUSH_LINE;
+    } else if (strcmp(flush, "each") == 0) {
+        interpreter->output.policy = FLUSH_EACH;
+    } else if (strcmp(flush, "auto") == 0) {
+        interpreter->output.policy = isatty(STDOUT_FILENO) ? FLUSH_LINE : FLUSH_FULL;
+    } else {
+        fprintf(stderr, "Error: Unknown flush policy '%s'\n", flush);
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    // Prompt before every read only when someone is typing the input
+    interpreter->input.interactive = isatty(STDIN_FILENO);
 
     int load_res = 0;
+    Snapshot snapshot = {0};
     if (execute_directly) {
         load_res = interpreter_load_str(interpreter, direct_code);
+    } else if (filename && cache) {
+        char* default_path = cache_path ? NULL : cache_path_for(filename);
+        load_res = cache_read_from_file(interpreter, filename, cache_path ? cache_path : default_path,
+                                        pre_eval ? &snapshot : NULL);
+        free(default_path);
     } else if (filename) {
         load_res = interpreter_read_from_file(interpreter, filename);
     } else {
@@ -78,15 +301,214 @@ int main(const int argc, char** argv) {
         return 1;
     }
 
-    interpreter_run(interpreter);
-    if (ferror(stdin)) {
+    if (fusion_stats) {
+        fusion_report(stderr, &interpreter->program);
+        verify_report(stderr, &interpreter->program);
+    }
+
+    if (listing_path) {
+        const int listing_res = list_program(interpreter, listing_path, filename ? filename : "-e");
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return listing_res == 0 ? 0 : 1;
+    }
+
+    if (emit_path) {
+        const int emit_res = emit_program(interpreter, emit_path, filename ? filename : "-e");
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return emit_res == 0 ? 0 : 1;
+    }
+
+    if (restore_path && checkpoint_restore(interpreter, restore_path) != 0) {
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    if (checkpoint_every && !checkpoint_path) {
+        fprintf(stderr, "Error: --checkpoint-every needs --checkpoint\n");
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    if (profile_path && checkpoint_path) {
+        fprintf(stderr, "Error: Cannot combine --profile and --checkpoint\n");
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    if ((max_steps || max_time > 0) && (profile_path || checkpoint_path)) {
+        fprintf(stderr, "Error: Cannot combine --max-steps or --max-time with --profile or --checkpoint\n");
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    if (sample_path && !sample_start(interpreter)) {
+        fprintf(stderr, "Error: Cannot sample here, no profiling timer\n");
+        snapshot_free(&snapshot);
+        interpreter_delete(interpreter);
+        return 1;
+    }
+
+    // A checkpoint to restore wins over the pre-evaluated start
+    const bool resumed = restore_path || snapshot_resume(interpreter, &snapshot);
+    snapshot_free(&snapshot);
+
+    int status = 0;
+    if (resumed && !interpreter->running) {
+        // Pre-evaluation ran it to the end
+    } else if (profile_path) {
+        if (!resumed) interpreter_reset(interpreter);
+        status = run_profiled(interpreter, profile_path, filename ? filename : "-e");
+    } else if (checkpoint_path) {
+        if (!resumed) interpreter_reset(interpreter);
+        status = run_checkpointed(interpreter, checkpoint_path, checkpoint_every);
+    } else if (max_steps || max_time > 0) {
+        if (!resumed) interpreter_reset(interpreter);
+        status = run_limited(interpreter, max_steps, max_time);
+    } else if (resumed) {
+        interpreter_continue(interpreter);
+    } else {
+        interpreter_run(interpreter);
+    }
+
+    if (sample_path) {
+        sample_stop();
+        if (sample_write(sample_path, filename ? filename : "-e") != 0) status = 1;
+    }
+
+    if (interpreter->input.error) {
         fprintf(stderr, "Error reading from stdin\n");
     }
 
+    if (heap_stats) {
+        heap_report(stderr, &interpreter->heap);
+    }
+
     interpreter_delete(interpreter);
+    return status;
+}
+
+static void request_checkpoint(int signal) {
+    checkpoint_requested = 1;
+}
+
+// --checkpoint: run in slices of the step loop so the state can be saved
+// between any two instructions. Saves every `every` instructions (0: never)
+// and on CHECKPOINT_SIGNAL, which also ends the run. Returns the exit status
+int run_checkpointed(Interpreter* interpreter, const char* path, const uint64_t every) {
+    signal(CHECKPOINT_SIGNAL, request_checkpoint);
+
+    uint64_t since = 0;
+    while (interpreter->running) {
+        uint64_t slice = CHECKPOINT_SLICE;
+        if (every && every - since < slice) slice = every - since;
+
+        since += interpreter_step(interpreter, slice);
+        if (!interpreter->running) break;
+
+        if (checkpoint_requested) {
+            return checkpoint_save(interpreter, path) == 0 ? EXIT_PREEMPTED : 1;
+        }
+        if (every && since >= every) {
+            if (checkpoint_save(interpreter, path) != 0) return 1;
+            since = 0;
+        }
+    }
     return 0;
 }
 
+static double seconds_now(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// --max-steps and --max-time: run on fuel. Steps are counted exactly but
+// only looked at on taken branches, so a run may go past max_steps by the
+// rest of a straight run of code. The clock is read every LIMIT_SLICE
+// instructions. Returns the exit status, EXIT_LIMIT if a limit stopped it
+int run_limited(Interpreter* interpreter, const uint64_t max_steps, const double max_time) {
+    const double start = seconds_now();
+    uint64_t steps = 0;
+    const char* limit = NULL;
+
+    while (limit == NULL) {
+        int64_t slice = FUEL_UNLIMITED;
+        if (max_steps && max_steps - steps < (uint64_t)slice) slice = (int64_t)(max_steps - steps);
+        if (max_time > 0 && slice > LIMIT_SLICE) slice = LIMIT_SLICE;
+
+        interpreter->fuel = slice;
+        interpreter_continue(interpreter);
+        steps += (uint64_t)(slice - interpreter->fuel);
+        interpreter->fuel = FUEL_UNLIMITED;
+        if (!interpreter->running) return 0;
+
+        if (max_steps && steps >= max_steps) limit = "--max-steps";
+        else if (max_time > 0 && seconds_now() - start >= max_time) limit = "--max-time";
+    }
+
+    const int pc = interpreter->pc;
+    fprintf(stderr, "Stopped by %s\n", limit);
+    fprintf(stderr, "    instructions   %llu\n", (unsigned long long)steps);
+    fprintf(stderr, "    time           %.3f s\n", seconds_now() - start);
+    fprintf(stderr, "    next           slot %d, line %d\n", pc, interpreter->program.lines[pc]);
+    fprintf(stderr, "    stack depth    %d\n", interpreter->stack->top + 1);
+    fprintf(stderr, "    call depth     %d\n", interpreter->call_stack->top + 1);
+    fprintf(stderr, "    heap pages     %zu\n", interpreter->heap.pages);
+    return EXIT_LIMIT;
+}
+
+// --profile: count everything, report to stderr and write JSON to path
+int run_profiled(Interpreter* interpreter, const char* path, const char* name) {
+    Profile* profile = profile_run(interpreter);
+    if (profile == NULL) {
+        perror("Error allocating memory");
+        return 1;
+    }
+
+    profile_report(stderr, profile, interpreter);
+    const int res = profile_write_json(path, profile, interpreter, name);
+    profile_free(profile);
+    return res == 0 ? 0 : 1;
+}
+
+// --emit-c: the decoded program as a C translation unit (see aot.h)
+int emit_program(const Interpreter* interpreter, const char* path, const char* name) {
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == NULL) {
+        perror("Error opening output file");
+        return -1;
+    }
+
+    int res = emit_c(out, &interpreter->program, &interpreter->labels, name);
+    if (out != stdout && fclose(out) != 0) res = -1;
+    if (res != 0) {
+        fprintf(stderr, "Error writing C to %s\n", path);
+    }
+    return res;
+}
+
+// --listing: the program as it will run, after -O and fusion
+int list_program(const Interpreter* interpreter, const char* path, const char* name) {
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == NULL) {
+        perror("Error opening output file");
+        return -1;
+    }
+
+    int res = emit_listing(out, interpreter, name);
+    if (out != stdout && fclose(out) != 0) res = -1;
+    if (res != 0) {
+        fprintf(stderr, "Error writing listing to %s\n", path);
+    }
+    return res;
+}
+
 void print_version(void) {
     printf("Whitespace-interpreter v0.1\n");
     printf("Implementation of every Whitespace instruction\n");
@@ -99,6 +521,34 @@ void print_help(const char* program_name) {
     printf("Options:\n");
     printf("    -h                      Print this help.\n");
     printf("    -e                      Execute line directly\n");
+    printf("    -O LEVEL                Optimize at load: 0 none (default), 1 one pass of\n");
+    printf("                            folding, jump threading and dead code removal,\n");
+    printf("                            2 repeat until nothing changes\n");
+    printf("    --no-fuse               Do not fuse instruction sequences\n");
+    printf("    --fusion-stats          Report fused instructions and elided stack checks\n");
+    printf("                            to stderr\n");
+    printf("    --heap-stats            Report heap pages touched to stderr\n");
+    printf("    --flush=POLICY          Output flushing: auto, full, line or each\n");
+    printf("    --jit                   Compile to native code (x86-64)\n");
+    printf("    --emit-c=FILE           Write the program as C to FILE (- for stdout)\n");
+    printf("    --listing=FILE          Write the optimized program as a listing to FILE\n");
+    printf("                            (- for stdout)\n");
+    printf("    --batch=MANIFEST        Run the jobs listed in MANIFEST, one\n");
+    printf("                            'program input output' per line\n");
+    printf("    --threads=N             Worker threads for --batch (default: one per CPU)\n");
+    printf("    --checkpoint=FILE       Save the run to FILE and stop on SIGUSR1 (exit status 75)\n");
+    printf("    --checkpoint-every=N    With --checkpoint, also save every N instructions\n");
+    printf("    --restore=FILE          Resume the program from a checkpoint\n");
+    printf("    --cache[=FILE]          Keep the decoded program in FILE (default: <file>.wsc)\n");
+    printf("    --pre-eval              Run the program up to its first input once and keep\n");
+    printf("                            the state and output in the cache; later runs start\n");
+    printf("                            there (implies --cache)\n");
+    printf("    --profile[=FILE]        Count executed instructions, labels and calls; report\n");
+    printf("                            to stderr and as JSON to FILE (default: profile.json)\n");
+    printf("    --sample[=FILE]         Sample the call stack on a SIGPROF timer, folded stacks\n");
+    printf("                            for flame graphs to FILE (default: sample.folded)\n");
+    printf("    --max-steps=N           Stop after about N instructions (exit status 124)\n");
+    printf("    --max-time=SECONDS      Stop after SECONDS of wall-clock time (exit status 124)\n");
     printf("Examples:\n");
     printf("    %s program.ws           Execute from file\n", program_name);
     printf("    %s -e \"   \\t\\n\"     Execute inline code\n", program_name);
@@ -0,0 +1,285 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Load-time optimizer (-O), run on the decoded program before fusion. Each
+// pass rewrites slots in place and marks the ones it drops, then the code
+// is compacted and jump targets and label positions renumbered. A dropped
+// slot stands for the next kept one, so a slot something may jump to is
+// only dropped when falling through it does nothing.
+//   -O1 runs every pass once
+//   -O2 repeats them until a round changes nothing
+// The result takes fewer steps than the source did, which is what
+// --max-steps and --profile then count.
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "instruction.h"
+
+// Bounds -O2 on programs that keep offering something to fold
+#define OPTIMIZE_ROUNDS 16
+
+typedef struct {
+    Program *program;
+    LabelTable *labels;
+    bool *target;       // A jump, call or return may land on the slot
+    bool *dropped;      // Slot goes at the next compaction
+    int *index;         // Slot numbers after compaction
+    size_t slots;       // Slots the flags have room for, the length before any pass
+} Optimizer;
+
+typedef bool (*Pass)(Optimizer *o);
+
+static bool is_flow(const uint8_t opcode) {
+    return opcode == OP_CALL || opcode == OP_JUMP || opcode == OP_JZ || opcode == OP_JN;
+}
+
+static void find_targets(Optimizer *o) {
+    const Program *program = o->program;
+    memset(o->target, 0, o->slots * sizeof *o->target);
+    o->target[0] = true;
+
+    for (int i = 0; i < program->length; i++) {
+        const Op *op = &program->code[i];
+        if (!is_flow(op->opcode) || op->operand < 0) continue;
+
+        o->target[op->operand] = true;
+        if (op->opcode == OP_CALL) o->target[i + 1] = true;
+    }
+}
+
+// Remove the dropped slots. The final end is never dropped
+static void compact(Optimizer *o) {
+    Program *program = o->program;
+    const int length = program->length;
+
+    int kept = 0;
+    for (int i = 0; i < length; i++) {
+        if (!o->dropped[i]) o->index[i] = kept++;
+    }
+    if (kept == length) return;
+
+    for (int i = length - 2; i >= 0; i--) {
+        if (o->dropped[i]) o->index[i] = o->index[i + 1];
+    }
+
+    for (int i = 0; i < length; i++) {
+        if (o->dropped[i]) continue;
+
+        Op op = program->code[i];
+        if (is_flow(op.opcode) && op.operand >= 0) op.operand = o->index[op.operand];
+        program->code[o->index[i]] = op;
+        program->lines[o->index[i]] = program->lines[i];
+    }
+    program->length = kept;
+
+    for (int i = 0; i < o->labels->count; i++) {
+        Label *label = &o->labels->entries[i];
+        if (label->position >= 0) label->position = o->index[label->position];
+    }
+}
+
+static int next_kept(const Optimizer *o, int i) {
+    do {
+        i++;
+    } while (o->dropped[i]);
+    return i;
+}
+
+// Same results as the instructions, nothing that would stop the program
+// or not fit a push operand
+static bool fold(const uint8_t opcode, const int64_t a, const int64_t b, int *result) {
+    int64_t r;
+    switch (opcode) {
+        case OP_ADD: r = a + b; break;
+        case OP_SUB: r = a - b; break;
+        case OP_MUL: r = a * b; break;
+        case OP_DIV: if (b == 0) return false; r = a / b; break;
+        case OP_MOD: if (b == 0) return false; r = a % b; break;
+        default: return false;
+    }
+    if (r < INT_MIN || r > INT_MAX) return false;
+
+    *result = (int)r;
+    return true;
+}
+
+// push a; push b; add becomes push a+b. Going backwards folds nested
+// expressions into their operands before the outer ones are looked at
+static bool fold_constants(Optimizer *o) {
+    Op *code = o->program->code;
+    bool changed = false;
+
+    for (int i = o->program->length - 1; i >= 0; i--) {
+        if (code[i].opcode != OP_PUSH) continue;
+
+        for (;;) {
+            const int j = next_kept(o, i);
+            if (o->target[j] || code[j].opcode != OP_PUSH) break;
+            const int k = next_kept(o, j);
+            if (o->target[k]) break;
+
+            int result;
+            if (!fold(code[k].opcode, code[i].operand, code[j].operand, &result)) break;
+
+            code[i].operand = result;
+            o->dropped[j] = true;
+            o->dropped[k] = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// push 0; jz L becomes jump L. A branch never taken becomes a jump past
+// it, which thread_jumps drops
+static bool fold_branches(Optimizer *o) {
+    Op *code = o->program->code;
+    bool changed = false;
+
+    for (int i = 0; i + 1 < o->program->length; i++) {
+        const Op *branch = &code[i + 1];
+        if (code[i].opcode != OP_PUSH || o->target[i + 1] || branch->operand < 0 ||
+            (branch->opcode != OP_JZ && branch->opcode != OP_JN)) {
+            continue;
+        }
+
+        const int n = code[i].operand;
+        const bool taken = branch->opcode == OP_JZ ? n == 0 : n < 0;
+        code[i] = (Op){OP_JUMP, taken ? branch->operand : i + 2};
+        o->dropped[i + 1] = true;
+        changed = true;
+    }
+    return changed;
+}
+
+// Where a jump to target ends up. A cycle of jumps is left to spin
+static int final_target(const Program *program, int target) {
+    for (int n = 0; n < program->length; n++) {
+        const Op *op = &program->code[target];
+        if (op->opcode != OP_JUMP || op->operand < 0) break;
+        target = op->operand;
+    }
+    return target;
+}
+
+// Jumps, calls and branches to a jump go straight to where it leads. A
+// jump to end or ret does that itself, a jump to the next slot goes
+static bool thread_jumps(Optimizer *o) {
+    Program *program = o->program;
+    bool changed = false;
+
+    for (int i = 0; i < program->length; i++) {
+        Op *op = &program->code[i];
+        if (!is_flow(op->opcode) || op->operand < 0) continue;
+
+        const int target = final_target(program, op->operand);
+        if (target != op->operand) {
+            op->operand = target;
+            changed = true;
+        }
+        if (op->opcode != OP_JUMP) continue;
+
+        const uint8_t landing = program->code[target].opcode;
+        if (landing == OP_END || landing == OP_RET) {
+            // Keep the line a ret without a call reports
+            *op = (Op){landing, 0};
+            program->lines[i] = program->lines[target];
+            changed = true;
+        } else if (target == i + 1) {
+            o->dropped[i] = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Drop what no run from slot 0 reaches: code after end, ret or a jump
+// that nothing jumps to
+static bool drop_unreachable(Optimizer *o) {
+    const Program *program = o->program;
+    const int length = program->length;
+
+    // Reuse the flags: dropped holds "not reached yet", index the work list
+    int *pending = o->index;
+    int pending_count = 0;
+    for (int i = 0; i < length; i++) {
+        o->dropped[i] = true;
+    }
+    #define REACH(slot) do { \
+        if (o->dropped[slot]) { o->dropped[slot] = false; pending[pending_count++] = (slot); } \
+    } while (0)
+
+    REACH(0);
+    while (pending_count > 0) {
+        const int i = pending[--pending_count];
+        const Op *op = &program->code[i];
+
+        switch (op->opcode) {
+            case OP_END:
+            case OP_RET:
+                break;
+
+            case OP_JUMP:
+                if (op->operand >= 0) REACH(op->operand);
+                break;
+
+            // Undefined labels (negative targets) stop the program
+            case OP_CALL:
+            case OP_JZ:
+            case OP_JN:
+                if (op->operand < 0) break;
+                REACH(op->operand);
+                REACH(i + 1);
+                break;
+
+            default:
+                REACH(i + 1);
+                break;
+        }
+    }
+    #undef REACH
+
+    o->dropped[length - 1] = false;
+    for (int i = 0; i < length; i++) {
+        if (o->dropped[i]) return true;
+    }
+    return false;
+}
+
+static bool run_pass(Optimizer *o, const Pass pass) {
+    find_targets(o);
+    memset(o->dropped, 0, o->slots * sizeof *o->dropped);
+
+    const bool changed = pass(o);
+    compact(o);
+    return changed;
+}
+
+void optimize_program(Interpreter *interpreter) {
+    Program *program = &interpreter->program;
+    const int length = program->length;
+    if (interpreter->optimize <= 0 || length == 0) return;
+
+    Optimizer o = {.program = program, .labels = &interpreter->labels, .slots = (size_t)length};
+    o.target = malloc(o.slots * sizeof *o.target);
+    o.dropped = malloc(o.slots * sizeof *o.dropped);
+    o.index = malloc(o.slots * sizeof *o.index);
+
+    // Without memory the program runs as written
+    if (o.target != NULL && o.dropped != NULL && o.index != NULL) {
+        for (int round = 0; round < OPTIMIZE_ROUNDS; round++) {
+            bool changed = run_pass(&o, fold_constants);
+            changed |= run_pass(&o, fold_branches);
+            changed |= run_pass(&o, thread_jumps);
+            changed |= run_pass(&o, drop_unreachable);
+            if (!changed || interpreter->optimize < 2) break;
+        }
+    }
+
+    free(o.target);
+    free(o.dropped);
+    free(o.index);
+}
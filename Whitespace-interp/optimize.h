@@ -0,0 +1,15 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "interpreter.h"
+
+// Highest level -O takes
+#define OPTIMIZE_MAX 2
+
+void optimize_program(Interpreter *interpreter);
+
+#endif //OPTIMIZE_H
@@ -0,0 +1,111 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Pre-evaluation (--pre-eval). Until a program reads input it does the same
+// on every run, so that part is run once at load and the state it reaches
+// kept in the cache with the output it wrote (see cache.c). Later runs
+// write the output and carry on from the state. Any point before the first
+// input will do, so a prologue longer than the step budget is cut there.
+
+#include <stdlib.h>
+#include <string.h>
+#include "preeval.h"
+#include "checkpoint.h"
+
+// Instructions run at load at most, one handler call each
+#define PREEVAL_STEPS (1 << 24)
+
+// Output collected while pre-evaluating
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;        // Out of memory
+} Capture;
+
+static size_t capture_write(void *user, const char *data, const size_t size) {
+    Capture *capture = user;
+    if (capture->failed) return size;
+
+    if (capture->length + size > capture->capacity) {
+        size_t capacity = capture->capacity ? capture->capacity * 2 : OUTPUT_SIZE;
+        while (capacity < capture->length + size) capacity *= 2;
+
+        char *grown = realloc(capture->data, capacity);
+        if (grown == NULL) {
+            capture->failed = true;
+            return size;
+        }
+        capture->data = grown;
+        capture->capacity = capacity;
+    }
+
+    memcpy(capture->data + capture->length, data, size);
+    capture->length += size;
+    return size;
+}
+
+// The real run reports the error again
+static size_t discard_write(void *user, const char *data, const size_t size) {
+    return size;
+}
+
+void snapshot_take(Interpreter *interpreter, Snapshot *snapshot) {
+    *snapshot = (Snapshot){0};
+
+    Output *output = &interpreter->output;
+    const StreamWrite write = output->write;
+    void *const user = output->user;
+    const StreamWrite error_write = interpreter->error_write;
+
+    Capture capture = {0};
+    output->write = capture_write;
+    output->user = &capture;
+    interpreter->error_write = discard_write;
+
+    interpreter_reset(interpreter);
+    interpreter_step_to_input(interpreter, PREEVAL_STEPS);
+
+    output->write = write;
+    output->user = user;
+    interpreter->error_write = error_write;
+
+    if (!interpreter->failed && !capture.failed) {
+        snapshot->finished = !interpreter->running;
+        if (!snapshot->finished) {
+            snapshot->state = checkpoint_encode(interpreter, &snapshot->state_size);
+        }
+        if (snapshot->finished || snapshot->state != NULL) {
+            snapshot->output = capture.data;
+            snapshot->output_size = capture.length;
+            capture.data = NULL;
+        }
+    }
+
+    free(capture.data);
+    interpreter_reset(interpreter);
+}
+
+bool snapshot_resume(Interpreter *interpreter, const Snapshot *snapshot) {
+    if (snapshot->finished) {
+        interpreter_reset(interpreter);
+        interpreter->running = false;
+    } else if (snapshot->state == NULL ||
+               checkpoint_decode(interpreter, snapshot->state, snapshot->state_size) != NULL) {
+        return false;
+    }
+
+    Output *output = &interpreter->output;
+    output_flush(output);
+    if (snapshot->output_size > 0) {
+        output->write(output->user, snapshot->output, snapshot->output_size);
+    }
+    return true;
+}
+
+void snapshot_free(Snapshot *snapshot) {
+    free(snapshot->output);
+    free(snapshot->state);
+    *snapshot = (Snapshot){0};
+}
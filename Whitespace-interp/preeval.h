@@ -0,0 +1,32 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef PREEVAL_H
+#define PREEVAL_H
+
+#include "interpreter.h"
+
+// Start of a program run once at load, up to its first input
+typedef struct {
+    char *output;           // What it wrote on the way
+    size_t output_size;
+    uint8_t *state;         // Checkpoint bytes (see checkpoint.h), NULL if it ended or failed
+    size_t state_size;
+    bool finished;          // It ended without reading input
+} Snapshot;
+
+// Run the loaded program from the start until it is about to read input,
+// ends or PREEVAL_STEPS instructions are done, with output captured. A run
+// that fails or runs out of memory leaves an empty snapshot, which starts
+// from the beginning. The interpreter is reset afterwards
+void snapshot_take(Interpreter *interpreter, Snapshot *snapshot);
+
+// Put the interpreter where the snapshot was taken and write its output.
+// false if it is empty or does not fit the program; a finished snapshot
+// leaves the interpreter stopped
+bool snapshot_resume(Interpreter *interpreter, const Snapshot *snapshot);
+
+void snapshot_free(Snapshot *snapshot);
+
+#endif //PREEVAL_H
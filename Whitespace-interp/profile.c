@@ -0,0 +1,361 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// --profile: exact counts. The program runs through the handler table with
+// a counter per slot. The handler of a fused slot runs only its first
+// instruction, so every source instruction is counted in its own slot. A
+// shadow of the call stack times each subroutine from call to ret.
+// Recursive calls are inside the outermost one, so only that one adds its
+// time
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+    #define PROFILE_TSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define PROFILE_TSC
+#endif
+#include "profile.h"
+#include "instruction.h"
+#include "fusion.h"
+#include "guard.h"
+
+// Rows of each table in the text report
+#define PROFILE_TOP 20
+
+#ifdef PROFILE_TSC
+    #define PROFILE_UNIT "cycles"
+#else
+    #define PROFILE_UNIT "ns"
+#endif
+
+typedef struct ProfileFrame {
+    int target;
+    uint64_t start;
+} ProfileFrame;
+
+typedef struct {
+    uint64_t count;
+    int index;
+} Row;
+
+static uint64_t profile_clock(void) {
+#ifdef PROFILE_TSC
+    return __rdtsc();
+#else
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+void profile_free(Profile *profile) {
+    if (profile == NULL) return;
+
+    free(profile->counts);
+    free(profile->calls);
+    free(profile->cycles);
+    free(profile->active);
+    free(profile->frames);
+    free(profile);
+}
+
+static void profile_enter(Profile *profile, const int target) {
+    if (profile->frame_count == profile->frame_capacity) {
+        const int capacity = profile->frame_capacity ? profile->frame_capacity * 2 : 64;
+        ProfileFrame *frames = realloc(profile->frames, capacity * sizeof(ProfileFrame));
+        if (frames == NULL) return;
+        profile->frames = frames;
+        profile->frame_capacity = capacity;
+    }
+
+    profile->frames[profile->frame_count++] = (ProfileFrame){target, profile_clock()};
+    profile->calls[target]++;
+    profile->active[target]++;
+}
+
+static void profile_leave(Profile *profile) {
+    // Returns from calls made before the run, e.g. after --restore
+    if (profile->frame_count == 0) return;
+
+    const ProfileFrame *frame = &profile->frames[--profile->frame_count];
+    if (--profile->active[frame->target] == 0) {
+        profile->cycles[frame->target] += profile_clock() - frame->start;
+    }
+}
+
+static void profile_loop(Interpreter *interpreter, void *context) {
+    Profile *profile = context;
+    const Op *code = interpreter->program.code;
+    const Stack *calls = interpreter->call_stack;
+
+    while (interpreter->running) {
+        const int depth = calls->top;
+        const Op *op = &code[interpreter->pc];
+        profile->counts[interpreter->pc++]++;
+        handler_table[op->opcode](interpreter, op->operand);
+
+        // Call and return show as a change in depth, pc is the callee
+        if (calls->top > depth) {
+            profile_enter(profile, interpreter->pc);
+        } else if (calls->top < depth) {
+            profile_leave(profile);
+        }
+    }
+}
+
+Profile* profile_run(Interpreter *interpreter) {
+    const int length = interpreter->program.length;
+
+    Profile *profile = calloc(1, sizeof(Profile));
+    if (profile == NULL) return NULL;
+    profile->length = length;
+    profile->counts = calloc(length, sizeof(uint64_t));
+    profile->calls = calloc(length, sizeof(uint64_t));
+    profile->cycles = calloc(length, sizeof(uint64_t));
+    profile->active = calloc(length, sizeof(int));
+    if (profile->counts == NULL || profile->calls == NULL || profile->cycles == NULL || profile->active == NULL) {
+        profile_free(profile);
+        return NULL;
+    }
+
+    guard_run(interpreter, profile_loop, profile);
+
+    // The program may end inside subroutines
+    while (profile->frame_count > 0) {
+        profile_leave(profile);
+    }
+
+    output_flush(&interpreter->output);
+    return profile;
+}
+
+// REPORTS
+
+// Source instruction of a slot: fused slots by their first one, pushes of
+// large numbers as pushes
+static uint8_t slot_opcode(const Program *program, const int i) {
+    const uint8_t opcode = fusion_first(program->code[i].opcode);
+    return opcode == OP_PUSH_CONST ? OP_PUSH : opcode;
+}
+
+static int row_compare(const void *a, const void *b) {
+    const Row *x = a;
+    const Row *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->index - y->index;
+}
+
+// Non-zero counts, largest first. Sets *count to the number of rows
+static Row* sorted_rows(const uint64_t *counts, const int length, int *count) {
+    Row *rows = malloc((length > 0 ? length : 1) * sizeof(Row));
+    if (rows == NULL) return NULL;
+
+    *count = 0;
+    for (int i = 0; i < length; i++) {
+        if (counts[i] > 0) rows[(*count)++] = (Row){counts[i], i};
+    }
+    qsort(rows, *count, sizeof(Row), row_compare);
+    return rows;
+}
+
+// First label marking each slot, -1 where there is none
+static int* labels_by_slot(const Interpreter *interpreter) {
+    const int length = interpreter->program.length;
+    int *label_at = malloc(length * sizeof(int));
+    if (label_at == NULL) return NULL;
+
+    for (int i = 0; i < length; i++) {
+        label_at[i] = -1;
+    }
+    for (int id = interpreter->labels.count - 1; id >= 0; id--) {
+        const int position = interpreter->labels.entries[id].position;
+        if (position >= 0 && position < length) label_at[position] = id;
+    }
+    return label_at;
+}
+
+// Everything the reports share
+typedef struct {
+    uint64_t opcodes[OP_COUNT];
+    uint64_t total;
+    int *label_at;
+    Row *slots;
+    int slot_count;
+    Row *subroutines;
+    int subroutine_count;
+} Summary;
+
+static void summary_free(Summary *summary) {
+    free(summary->label_at);
+    free(summary->slots);
+    free(summary->subroutines);
+}
+
+static int summarize(Summary *summary, const Profile *profile, const Interpreter *interpreter) {
+    const Program *program = &interpreter->program;
+    memset(summary, 0, sizeof(Summary));
+
+    summary->label_at = labels_by_slot(interpreter);
+    if (summary->label_at == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < profile->length; i++) {
+        summary->opcodes[slot_opcode(program, i)] += profile->counts[i];
+        summary->total += profile->counts[i];
+    }
+
+    summary->slots = sorted_rows(profile->counts, profile->length, &summary->slot_count);
+    summary->subroutines = sorted_rows(profile->cycles, profile->length, &summary->subroutine_count);
+    if (summary->slots == NULL || summary->subroutines == NULL) {
+        summary_free(summary);
+        return -1;
+    }
+    return 0;
+}
+
+static const char* label_name(const Interpreter *interpreter, const int id) {
+    if (id < 0) return "-";
+    return interpreter->labels.entries[id].length > 0 ? interpreter->labels.entries[id].name : "\"\"";
+}
+
+void profile_report(FILE *out, const Profile *profile, const Interpreter *interpreter) {
+    const Program *program = &interpreter->program;
+    Summary summary;
+    if (summarize(&summary, profile, interpreter) != 0) {
+        perror("Error allocating memory");
+        return;
+    }
+
+    fprintf(out, "Profile: %llu instructions\n", (unsigned long long)summary.total);
+
+    fprintf(out, "Opcodes:\n");
+    int opcode_count;
+    Row *opcodes = sorted_rows(summary.opcodes, OP_COUNT, &opcode_count);
+    for (int n = 0; opcodes != NULL && n < opcode_count; n++) {
+        fprintf(out, "    %-12s %14llu %6.2f%%\n", opcode_names[opcodes[n].index],
+                (unsigned long long)opcodes[n].count, 100.0 * (double)opcodes[n].count / (double)summary.total);
+    }
+    free(opcodes);
+
+    fprintf(out, "Hottest instructions:\n");
+    for (int n = 0; n < summary.slot_count && n < PROFILE_TOP; n++) {
+        const int i = summary.slots[n].index;
+        fprintf(out, "    slot %-6d line %-6d %-12s %14llu\n", i, program->lines[i],
+                opcode_names[slot_opcode(program, i)], (unsigned long long)summary.slots[n].count);
+    }
+
+    fprintf(out, "Labels:\n");
+    int shown = 0;
+    for (int n = 0; n < summary.slot_count && shown < PROFILE_TOP; n++) {
+        const int i = summary.slots[n].index;
+        if (summary.label_at[i] < 0) continue;
+
+        fprintf(out, "    %-20s line %-6d %14llu\n", label_name(interpreter, summary.label_at[i]),
+                program->lines[i], (unsigned long long)summary.slots[n].count);
+        shown++;
+    }
+
+    fprintf(out, "Subroutines (inclusive %s):\n", PROFILE_UNIT);
+    for (int n = 0; n < summary.subroutine_count && n < PROFILE_TOP; n++) {
+        const int i = summary.subroutines[n].index;
+        fprintf(out, "    %-20s calls %-12llu %16llu %12llu per call\n", label_name(interpreter, summary.label_at[i]),
+                (unsigned long long)profile->calls[i], (unsigned long long)profile->cycles[i],
+                (unsigned long long)(profile->cycles[i] / profile->calls[i]));
+    }
+
+    summary_free(&summary);
+}
+
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void json_label(FILE *out, const Interpreter *interpreter, const int id) {
+    if (id < 0) fprintf(out, "null");
+    else json_string(out, interpreter->labels.entries[id].name);
+}
+
+int profile_write_json(const char *path, const Profile *profile, const Interpreter *interpreter, const char *name) {
+    const Program *program = &interpreter->program;
+    Summary summary;
+    if (summarize(&summary, profile, interpreter) != 0) {
+        perror("Error allocating memory");
+        return -1;
+    }
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror("Error opening profile");
+        summary_free(&summary);
+        return -1;
+    }
+
+    fprintf(out, "{\n  \"program\": ");
+    json_string(out, name);
+    fprintf(out, ",\n  \"unit\": \"%s\",\n  \"instructions\": %llu,\n", PROFILE_UNIT,
+            (unsigned long long)summary.total);
+
+    fprintf(out, "  \"opcodes\": {");
+    const char *separator = "\n";
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (summary.opcodes[op] == 0) continue;
+        fprintf(out, "%s    \"%s\": %llu", separator, opcode_names[op], (unsigned long long)summary.opcodes[op]);
+        separator = ",\n";
+    }
+    fprintf(out, "\n  },\n");
+
+    // Every slot that ran, hottest first
+    fprintf(out, "  \"slots\": [");
+    for (int n = 0; n < summary.slot_count; n++) {
+        const int i = summary.slots[n].index;
+        fprintf(out, "%s\n    {\"slot\": %d, \"line\": %d, \"opcode\": \"%s\", \"label\": ", n ? "," : "",
+                i, program->lines[i], opcode_names[slot_opcode(program, i)]);
+        json_label(out, interpreter, summary.label_at[i]);
+        fprintf(out, ", \"count\": %llu}", (unsigned long long)summary.slots[n].count);
+    }
+    fprintf(out, "\n  ],\n");
+
+    fprintf(out, "  \"labels\": [");
+    separator = "";
+    for (int id = 0; id < interpreter->labels.count; id++) {
+        const int position = interpreter->labels.entries[id].position;
+        if (position < 0) continue;
+
+        fprintf(out, "%s\n    {\"label\": ", separator);
+        json_string(out, interpreter->labels.entries[id].name);
+        fprintf(out, ", \"slot\": %d, \"line\": %d, \"count\": %llu}", position, program->lines[position],
+                (unsigned long long)profile->counts[position]);
+        separator = ",";
+    }
+    fprintf(out, "\n  ],\n");
+
+    fprintf(out, "  \"subroutines\": [");
+    for (int n = 0; n < summary.subroutine_count; n++) {
+        const int i = summary.subroutines[n].index;
+        fprintf(out, "%s\n    {\"label\": ", n ? "," : "");
+        json_label(out, interpreter, summary.label_at[i]);
+        fprintf(out, ", \"slot\": %d, \"calls\": %llu, \"inclusive\": %llu}", i,
+                (unsigned long long)profile->calls[i], (unsigned long long)profile->cycles[i]);
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    summary_free(&summary);
+    if (fclose(out) != 0) {
+        perror("Error writing profile");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "interpreter.h"
+
+// Exact execution counts of one run (see profile.c)
+typedef struct {
+    uint64_t *counts;       // Dispatches per slot
+    uint64_t *calls;        // Calls per target slot
+    uint64_t *cycles;       // Inclusive clock ticks per target slot, recursion counted once
+    int *active;            // Frames of each target slot on the call stack
+    struct ProfileFrame *frames;    // Mirrors the call stack
+    int frame_count;
+    int frame_capacity;
+    int length;
+} Profile;
+
+// Run from pc until the program stops, like interpreter_continue but one
+// counted handler call per instruction. Returns NULL if out of memory,
+// without running anything
+Profile* profile_run(Interpreter *interpreter);
+void profile_free(Profile *profile);
+
+// Sorted summary for people
+void profile_report(FILE *out, const Profile *profile, const Interpreter *interpreter);
+// Everything, as JSON. 0 on success
+int profile_write_json(const char *path, const Profile *profile, const Interpreter *interpreter, const char *name);
+
+#endif //PROFILE_H
@@ -0,0 +1,229 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// --sample: statistical profile for long runs. A SIGPROF timer interrupts
+// the process SAMPLE_HZ times per CPU second; the handler reads the call
+// stack and pc of the running program, maps them to labels and adds one to
+// that stack in a table allocated up front. Nothing is done per
+// instruction, so the cost does not depend on how fast the program runs.
+//
+// A frame is the label of a called subroutine, the leaf the last label at
+// or before pc. The fast engines and --jit keep the last branch target in
+// pc, the handler-table loops the exact position.
+
+// setitimer is not part of strict C/POSIX modes
+#define _DEFAULT_SOURCE
+
+#include "sample.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "instruction.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+
+// Distinct stacks kept, a power of two
+#define SAMPLE_STACKS 16384
+// Label ids of all distinct stacks together
+#define SAMPLE_FRAMES (1 << 20)
+// Calls kept from the bottom of the call stack
+#define SAMPLE_DEPTH 256
+
+typedef struct {
+    uint64_t hash;
+    uint64_t count;     // 0 while the entry is free
+    int offset;         // First label id in frames
+    int depth;
+} SampleStack;
+
+// Everything the handler touches, set up before the timer starts
+static struct {
+    const Interpreter *interpreter;
+    const Op *code;
+    int length;
+    int *block_of;      // Last label id at or before each slot, -1 before the first
+    SampleStack *stacks;
+    int *frames;
+    int frame_count;
+    uint64_t dropped;   // Samples that did not fit
+    struct sigaction previous;
+} sampler;
+
+// Label ids of the running program, outermost call first, into ids.
+// Returns how many
+static int sample_take(int *ids) {
+    const Stack *calls = sampler.interpreter->call_stack;
+    int top = calls->top;
+    if (top >= SAMPLE_DEPTH) top = SAMPLE_DEPTH - 1;
+
+    int depth = 0;
+    for (int i = 0; i <= top; i++) {
+        // Return slot follows the call, whose operand is the subroutine
+        const int back = (int)calls->data[i] - 1;
+        if (back < 0 || back >= sampler.length) continue;
+
+        const int target = sampler.code[back].operand;
+        if (target < 0 || target >= sampler.length || sampler.block_of[target] < 0) continue;
+        ids[depth++] = sampler.block_of[target];
+    }
+
+    const int pc = sampler.interpreter->pc;
+    if (pc >= 0 && pc < sampler.length && sampler.block_of[pc] >= 0) {
+        ids[depth++] = sampler.block_of[pc];
+    }
+    return depth;
+}
+
+static void sample_record(const int *ids, const int depth) {
+    uint64_t hash = 14695981039346656037u;
+    for (int i = 0; i < depth; i++) {
+        hash = (hash ^ (uint32_t)ids[i]) * 1099511628211u;
+    }
+
+    for (int probe = 0; probe < SAMPLE_STACKS; probe++) {
+        SampleStack *entry = &sampler.stacks[(hash + probe) & (SAMPLE_STACKS - 1)];
+
+        if (entry->count == 0) {
+            if (sampler.frame_count + depth > SAMPLE_FRAMES) break;
+            memcpy(&sampler.frames[sampler.frame_count], ids, depth * sizeof(int));
+            *entry = (SampleStack){hash, 1, sampler.frame_count, depth};
+            sampler.frame_count += depth;
+            return;
+        }
+
+        if (entry->hash == hash && entry->depth == depth &&
+            memcmp(&sampler.frames[entry->offset], ids, depth * sizeof(int)) == 0) {
+            entry->count++;
+            return;
+        }
+    }
+    sampler.dropped++;
+}
+
+static void on_sample(int signal) {
+    const int saved = errno;
+    int ids[SAMPLE_DEPTH + 1];
+    sample_record(ids, sample_take(ids));
+    errno = saved;
+}
+
+static void sample_free(void) {
+    free(sampler.block_of);
+    free(sampler.stacks);
+    free(sampler.frames);
+    memset(&sampler, 0, sizeof(sampler));
+}
+
+bool sample_start(Interpreter *interpreter) {
+    const int length = interpreter->program.length;
+
+    sampler.interpreter = interpreter;
+    sampler.code = interpreter->program.code;
+    sampler.length = length;
+    sampler.block_of = malloc((length > 0 ? length : 1) * sizeof(int));
+    sampler.stacks = calloc(SAMPLE_STACKS, sizeof(SampleStack));
+    sampler.frames = malloc(SAMPLE_FRAMES * sizeof(int));
+    if (sampler.block_of == NULL || sampler.stacks == NULL || sampler.frames == NULL) {
+        sample_free();
+        return false;
+    }
+
+    // First label marking each slot, then carried forward over the slots
+    // without one
+    for (int i = 0; i < length; i++) {
+        sampler.block_of[i] = -1;
+    }
+    for (int id = interpreter->labels.count - 1; id >= 0; id--) {
+        const int position = interpreter->labels.entries[id].position;
+        if (position >= 0 && position < length) sampler.block_of[position] = id;
+    }
+    for (int i = 1; i < length; i++) {
+        if (sampler.block_of[i] < 0) sampler.block_of[i] = sampler.block_of[i - 1];
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &sampler.previous) != 0) {
+        sample_free();
+        return false;
+    }
+
+    const struct itimerval timer = {{0, 1000000 / SAMPLE_HZ}, {0, 1000000 / SAMPLE_HZ}};
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        sigaction(SIGPROF, &sampler.previous, NULL);
+        sample_free();
+        return false;
+    }
+    return true;
+}
+
+void sample_stop(void) {
+    const struct itimerval off = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_PROF, &off, NULL);
+    sigaction(SIGPROF, &sampler.previous, NULL);
+}
+
+static void write_label(FILE *out, const int id) {
+    const Label *label = &sampler.interpreter->labels.entries[id];
+    fputs(label->length > 0 ? label->name : "\"\"", out);
+}
+
+int sample_write(const char *path, const char *name) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror("Error opening samples");
+        sample_free();
+        return -1;
+    }
+
+    uint64_t total = 0;
+    for (int n = 0; n < SAMPLE_STACKS; n++) {
+        const SampleStack *entry = &sampler.stacks[n];
+        if (entry->count == 0) continue;
+
+        fputs(name, out);
+        for (int i = 0; i < entry->depth; i++) {
+            fputc(';', out);
+            write_label(out, sampler.frames[entry->offset + i]);
+        }
+        fprintf(out, " %llu\n", (unsigned long long)entry->count);
+        total += entry->count;
+    }
+
+    if (sampler.dropped > 0) {
+        fprintf(stderr, "Warning: %llu of %llu samples dropped, too many distinct stacks\n",
+                (unsigned long long)sampler.dropped, (unsigned long long)(total + sampler.dropped));
+    }
+
+    sample_free();
+    if (fclose(out) != 0) {
+        perror("Error writing samples");
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+// No SIGPROF or interval timers
+bool sample_start(Interpreter *interpreter) {
+    return false;
+}
+
+void sample_stop(void) {
+}
+
+int sample_write(const char *path, const char *name) {
+    return -1;
+}
+
+#endif
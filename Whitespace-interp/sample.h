@@ -0,0 +1,23 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdbool.h>
+#include "interpreter.h"
+
+// Samples per second of CPU time
+#define SAMPLE_HZ 997
+
+// Start sampling interpreter on a SIGPROF timer. One sampler per process.
+// False if the platform has no profiling timer or memory ran out
+bool sample_start(Interpreter *interpreter);
+// Stop the timer; the samples stay until sample_write
+void sample_stop(void);
+// Write the samples as folded stacks ("root;frame;...;leaf count" lines,
+// as flamegraph.pl takes them) and free them. 0 on success
+int sample_write(const char *path, const char *name);
+
+#endif //SAMPLE_H
@@ -0,0 +1,185 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Program source. The file is mapped rather than read where the platform
+// has mmap, and the decoder works on its tokens only: source_scan copies
+// out the space, tab and linefeed bytes 32 at a time, so runs of comment
+// cost a compare per block instead of a branch per byte.
+
+// mmap and friends are not part of strict C modes
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+#include "source.h"
+#include "interpreter.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+    #define SOURCE_SSE2 1
+    #include <immintrin.h>
+#endif
+
+// AVX2 kernel built alongside, taken when the CPU has it
+#if SOURCE_SSE2 && defined(__x86_64__)
+    #define SOURCE_AVX2 1
+#endif
+
+#define SCAN_BLOCK 32
+
+// Files that cannot be mapped (empty, pipes, Windows) are read to the end
+static char* read_source(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    size_t size = 0;
+    size_t capacity = 4096;
+    char *data = malloc(capacity);
+    while (data != NULL) {
+        size += fread(data + size, 1, capacity - size, file);
+        if (size < capacity) break;
+
+        char *grown = realloc(data, capacity * 2);
+        if (grown == NULL) free(data);
+        data = grown;
+        capacity *= 2;
+    }
+
+    if (data != NULL && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    if (data != NULL) *length = size;
+    return data;
+}
+
+char* source_map(const char *path, size_t *length, size_t *mapping_size) {
+    *mapping_size = 0;
+#ifndef _WIN32
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+            *length = *mapping_size = (size_t)info.st_size;
+            return data;
+        }
+    }
+    close(fd);
+#endif
+    return read_source(path, length);
+}
+
+void source_release(char *source, const size_t mapping_size) {
+#ifndef _WIN32
+    if (mapping_size != 0) {
+        munmap(source, mapping_size);
+        return;
+    }
+#else
+    (void)mapping_size;
+#endif
+    free(source);
+}
+
+#if SOURCE_SSE2
+// Append the tokens of a block, one mask bit per byte. Blocks of comment
+// have no bits and blocks of pure Whitespace are copied whole
+static inline size_t scan_block(const char *block, const size_t base, const uint32_t mask,
+                                char *tokens, int *offsets, size_t count) {
+    if (mask == UINT32_MAX) {
+        memcpy(tokens + count, block, SCAN_BLOCK);
+        for (int i = 0; i < SCAN_BLOCK; i++) {
+            offsets[count + i] = (int)base + i;
+        }
+        return count + SCAN_BLOCK;
+    }
+
+    for (uint32_t bits = mask; bits != 0; bits &= bits - 1) {
+        const int i = __builtin_ctz(bits);
+        tokens[count] = block[i];
+        offsets[count] = (int)base + i;
+        count++;
+    }
+    return count;
+}
+
+static inline uint32_t mask_sse2(const __m128i bytes) {
+    const __m128i found = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(SPACE)), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(TAB))),
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8(LINEFEED)));
+    return (uint32_t)_mm_movemask_epi8(found);
+}
+
+// Scans whole blocks, returns the token count and sets *scanned
+static size_t scan_sse2(const char *source, const size_t length, char *tokens, int *offsets,
+                        size_t *scanned) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + SCAN_BLOCK <= length; i += SCAN_BLOCK) {
+        const uint32_t low = mask_sse2(_mm_loadu_si128((const __m128i *)(source + i)));
+        const uint32_t high = mask_sse2(_mm_loadu_si128((const __m128i *)(source + i + 16)));
+        count = scan_block(source + i, i, low | high << 16, tokens, offsets, count);
+    }
+    *scanned = i;
+    return count;
+}
+#endif
+
+#if SOURCE_AVX2
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char *source, const size_t length, char *tokens, int *offsets,
+                        size_t *scanned) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + SCAN_BLOCK <= length; i += SCAN_BLOCK) {
+        const __m256i bytes = _mm256_loadu_si256((const __m256i *)(source + i));
+        const __m256i found = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(SPACE)),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(TAB))),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(LINEFEED)));
+        count = scan_block(source + i, i, (uint32_t)_mm256_movemask_epi8(found), tokens, offsets, count);
+    }
+    *scanned = i;
+    return count;
+}
+#endif
+
+size_t source_scan(const char *source, const size_t length, char *tokens, int *offsets) {
+    size_t count = 0;
+    size_t i = 0;
+#if SOURCE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        count = scan_avx2(source, length, tokens, offsets, &i);
+    } else {
+        count = scan_sse2(source, length, tokens, offsets, &i);
+    }
+#elif SOURCE_SSE2
+    count = scan_sse2(source, length, tokens, offsets, &i);
+#endif
+
+    // The tail, or all of it without SIMD
+    for (; i < length; i++) {
+        const char c = source[i];
+        if (c == SPACE || c == TAB || c == LINEFEED) {
+            tokens[count] = c;
+            offsets[count] = (int)i;
+            count++;
+        }
+    }
+    return count;
+}
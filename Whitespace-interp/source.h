@@ -0,0 +1,19 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+// Contents of the file at path, not terminated. mapping_size is nonzero if
+// it is a mapping, to be released with source_release. NULL on error
+char* source_map(const char *path, size_t *length, size_t *mapping_size);
+void source_release(char *source, size_t mapping_size);
+
+// Copy the space, tab and linefeed bytes of source to tokens and where each
+// one sits to offsets, returns their count. Both need room for length
+size_t source_scan(const char *source, size_t length, char *tokens, int *offsets);
+
+#endif //SOURCE_H
@@ -0,0 +1,206 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#include "stream.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// stdout is unbuffered (see main.c), so this is a single write
+size_t stream_write_stdout(void *user, const char *data, const size_t size) {
+    return fwrite(data, 1, size, stdout);
+}
+
+size_t stream_write_stderr(void *user, const char *data, const size_t size) {
+    return fwrite(data, 1, size, stderr);
+}
+
+// read() returns whatever is available, so a terminal still delivers one
+// line at a time
+ptrdiff_t stream_read_stdin(void *user, char *buffer, const size_t size) {
+    ssize_t count;
+    do {
+        count = read(STDIN_FILENO, buffer, size);
+    } while (count < 0 && errno == EINTR);
+    return count;
+}
+
+void output_init(Output *output, const FlushPolicy policy) {
+    output->length = 0;
+    output->policy = policy;
+    output->write = stream_write_stdout;
+    output->user = NULL;
+}
+
+void output_flush(Output *output) {
+    if (output->length == 0) return;
+
+    output->write(output->user, output->data, output->length);
+    output->length = 0;
+}
+
+void output_char(Output *output, const int c) {
+    output->data[output->length++] = (char)c;
+
+    if (output->length == OUTPUT_SIZE || output->policy == FLUSH_EACH ||
+        (output->policy == FLUSH_LINE && c == '\n')) {
+        output_flush(output);
+    }
+}
+
+// Formatted straight into the buffer, very long bignums go through a
+// temporary one
+void output_number(Output *output, const Value v) {
+    const size_t size = value_format_size(v);
+
+    if (size > OUTPUT_SIZE - output->length) {
+        output_flush(output);
+    }
+
+    if (size <= OUTPUT_SIZE) {
+        output->length += value_format(v, output->data + output->length);
+    } else {
+        char *text = malloc(size);
+        if (text == NULL) {
+            perror("Error allocating memory");
+            exit(EXIT_FAILURE);
+        }
+        output->write(output->user, text, value_format(v, text));
+        free(text);
+    }
+
+    if (output->length == OUTPUT_SIZE || output->policy == FLUSH_EACH) {
+        output_flush(output);
+    }
+}
+
+// INPUT
+
+void input_init(Input *input, Output *output) {
+    input->data = NULL;
+    input->position = 0;
+    input->length = 0;
+    input->interactive = false;
+    input->eof = false;
+    input->error = false;
+    input->output = output;
+    input->read = stream_read_stdin;
+    input->user = NULL;
+}
+
+void input_free(Input *input) {
+    free(input->data);
+    input->data = NULL;
+    input->position = 0;
+    input->length = 0;
+}
+
+// Refill the buffer and return its first byte
+int input_fill(Input *input) {
+    if (input->eof) return EOF;
+
+    if (input->data == NULL) {
+        input->data = malloc(INPUT_SIZE);
+        if (input->data == NULL) {
+            perror("Error allocating memory");
+            input->eof = input->error = true;
+            return EOF;
+        }
+    }
+
+    // Whoever feeds the input may be waiting for our output
+    output_flush(input->output);
+
+    const ptrdiff_t count = input->read(input->user, input->data, INPUT_SIZE);
+
+    if (count <= 0) {
+        input->error = count < 0;
+        input->eof = true;
+        input->position = input->length = 0;
+        return EOF;
+    }
+
+    input->length = (size_t)count;
+    input->position = 1;
+    return (unsigned char)input->data[0];
+}
+
+static bool is_digit(const int c) {
+    return c >= '0' && c <= '9';
+}
+
+// Digits that continue past the end of the buffer are copied out while it
+// is refilled
+static Value input_long_number(Input *input, BigPool *pool, const int sign, int *c) {
+    size_t capacity = 64;
+    size_t length = 0;
+    char *digits = malloc(capacity);
+
+    while (digits != NULL && is_digit(*c)) {
+        if (length == capacity) {
+            char *grown = realloc(digits, capacity * 2);
+            if (grown == NULL) break;
+            digits = grown;
+            capacity *= 2;
+        }
+        digits[length++] = (char)*c;
+        *c = input_char(input);
+    }
+
+    if (digits == NULL) {
+        perror("Error allocating memory");
+        return value_from_small(0);
+    }
+
+    const Value value = value_from_decimal(pool, sign, digits, (int)length);
+    free(digits);
+    return value;
+}
+
+// One line of input as a decimal number: leading blanks, an optional sign
+// and digits; the rest of the line is ignored. Empty lines and EOF give 0
+Value input_number(Input *input, BigPool *pool) {
+    int c;
+
+    // Skip leading whitespace (spaces and tabs only)
+    do {
+        c = input_char(input);
+        if (c == EOF) return value_from_small(0);
+    } while (c == ' ' || c == '\t');
+
+    // Empty line = 0
+    if (c == '\n') return value_from_small(0);
+
+    int sign = 1;
+    if (c == '-' || c == '+') {
+        sign = (c == '-') ? -1 : 1;
+        c = input_char(input);
+    }
+
+    Value value = value_from_small(0);
+    if (is_digit(c)) {
+        // Parse in place when the digits end inside the buffer
+        const char *start = input->data + input->position - 1;
+        const char *end = start;
+        const char *limit = input->data + input->length;
+        while (end < limit && is_digit(*end)) end++;
+
+        if (end < limit) {
+            value = value_from_decimal(pool, sign, start, (int)(end - start));
+            input->position = (size_t)(end - input->data);
+            c = input_char(input);
+        } else {
+            value = input_long_number(input, pool, sign, &c);
+        }
+    }
+
+    // Consume rest of line
+    while (c != '\n' && c != EOF) {
+        c = input_char(input);
+    }
+
+    return value;
+}
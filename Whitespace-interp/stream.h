@@ -0,0 +1,72 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "value.h"
+
+#define OUTPUT_SIZE 4096
+#define INPUT_SIZE 65536
+
+// Where program output goes and input comes from, replaceable by an
+// embedding host (see whitespace.h). read returns the number of bytes
+// read, 0 at the end of input and -1 on errors
+typedef size_t (*StreamWrite)(void *user, const char *data, size_t size);
+typedef ptrdiff_t (*StreamRead)(void *user, char *buffer, size_t size);
+
+size_t stream_write_stdout(void *user, const char *data, size_t size);
+size_t stream_write_stderr(void *user, const char *data, size_t size);
+ptrdiff_t stream_read_stdin(void *user, char *buffer, size_t size);
+
+// When buffered program output is written to stdout. Every policy also
+// flushes on a full buffer, before input is read, on errors and at the end
+typedef enum {
+    FLUSH_FULL,         // Only then
+    FLUSH_LINE,         // And after each newline
+    FLUSH_EACH          // After every write, like the unbuffered stdout before
+} FlushPolicy;
+
+typedef struct {
+    char data[OUTPUT_SIZE];
+    size_t length;
+    FlushPolicy policy;
+    StreamWrite write;          // stdout by default
+    void* user;
+} Output;
+
+// Program input, read in blocks of up to INPUT_SIZE bytes
+typedef struct {
+    char* data;                 // Allocated on the first read
+    size_t position;            // Next byte; the byte last returned is at position - 1
+    size_t length;
+    bool interactive;           // stdin is a terminal: flush output before every input instruction
+    bool eof;
+    bool error;
+    Output* output;             // Flushed before blocking on a read
+    StreamRead read;            // stdin by default
+    void* user;
+} Input;
+
+void output_init(Output *output, FlushPolicy policy);
+void output_flush(Output *output);
+void output_char(Output *output, int c);
+void output_number(Output *output, Value v);
+
+void input_init(Input *input, Output *output);
+void input_free(Input *input);
+int input_fill(Input *input);
+Value input_number(Input *input, BigPool *pool);
+
+// Next input byte, EOF at the end of input
+static inline int input_char(Input *input) {
+    if (input->position < input->length) {
+        return (unsigned char)input->data[input->position++];
+    }
+    return input_fill(input);
+}
+
+#endif //STREAM_H
@@ -0,0 +1,568 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Direct-threaded run loop: every handler is inlined here and ends with its
+// own indirect jump to the next one (GCC/Clang labels-as-values). Other
+// compilers get the same handlers in a switch.
+// Only the common case is handled inline: I/O and every error path go
+// through the reference handlers in instruction.c, so messages stay the same.
+// Each checked opcode tests the stack depth and falls through into its
+// unchecked form (verify.c), which the loader puts where it cannot fail.
+// Values are tagged (see value.h): arithmetic stays inline while both
+// operands are small and the result does not overflow, anything involving
+// a bignum goes to the reference handler.
+
+#include <stdio.h>
+#include "interpreter.h"
+#include "instruction.h"
+#include "config.h"
+
+#if defined(__GNUC__) && __GNUC__ >= 7
+    #define FALLTHROUGH __attribute__((fallthrough));
+#else
+    #define FALLTHROUGH
+#endif
+
+// Unchecked handlers are also entered from the checked one above them
+#ifdef WS_ENGINE_THREADED
+    #define TARGET(opcode) L_##opcode:
+    #define UNCHECKED_TARGET(opcode) L_##opcode:
+    #define DISPATCH() do { op = ip++; goto *dispatch_table[op->opcode]; } while (0)
+#else
+    #define TARGET(opcode) case opcode:
+    #define UNCHECKED_TARGET(opcode) FALLTHROUGH case opcode:
+    #define DISPATCH() continue
+#endif
+
+// Value stack access. sp points at the top slot, so depth is sp - data + 1.
+// With WS_TOS_CACHE the top value lives in the local tos and its slot in
+// data is stale; the spare slot below data[0] absorbs spills of an empty
+// stack. Pops and pushes below are unchecked, handlers verify DEPTH() first
+// unless the loader proved it.
+#if WS_TOS_CACHE
+    #define TOS             tos
+    #define AT(n)           ((n) == 0 ? tos : sp[-(n)])
+#if WS_STACK_GUARD
+    // The pushed value's slot is read, so a push onto a full stack touches
+    // the guard page then and not one push later. A load, a store there
+    // slows the loop down
+    #define PUSH_FAST(v)    do { const Value pushed = (v); *sp++ = tos; (void)*(volatile const Value *)sp; tos = pushed; } while (0)
+#else
+    #define PUSH_FAST(v)    do { const Value pushed = (v); *sp++ = tos; tos = pushed; } while (0)
+#endif
+    #define DROP(n)         do { sp -= (n); tos = *sp; } while (0)
+    #define SPILL()         do { *sp = tos; stack->top = (int)(sp - data); } while (0)
+    #define RELOAD()        do { data = stack->data; sp = data + stack->top; tos = *sp; } while (0)
+#else
+    #define TOS             sp[0]
+    #define AT(n)           sp[-(n)]
+    #define PUSH_FAST(v)    do { const Value pushed = (v); *++sp = pushed; } while (0)
+    #define DROP(n)         (sp -= (n))
+    #define SPILL()         (stack->top = (int)(sp - data))
+    #define RELOAD()        do { data = stack->data; sp = data + stack->top; } while (0)
+#endif
+
+#ifdef __GNUC__
+    #define UNLIKELY(x)     __builtin_expect(!!(x), 0)
+#else
+    #define UNLIKELY(x)     (x)
+#endif
+
+#define NOS                 sp[-1]
+#define DEPTH()             ((int)(sp - data) + 1)
+
+#define BOTH_SMALL(a, b)    value_is_small((a) | (b))
+#define SMALL(n)            value_from_small(n)
+// Heap cell of an address if its page is already there, NULL sends the
+// access to the reference handler (absent pages, sparse cells, bignums)
+#define CELL(v)             (value_is_small(v) ? CELL_AT(value_small(v)) : NULL)
+#define CELL_AT(address)    heap_find(heap, (uintptr_t)(address))
+
+// Stacks full to their current capacity. With WS_STACK_GUARD a push past
+// the end faults on the guard page instead (guard.c)
+#if WS_STACK_GUARD
+    #define STACK_FULL()    false
+    #define CALLS_FULL()    false
+#else
+    #define STACK_FULL()    (sp >= data + stack->capacity - 1)
+    #define CALLS_FULL()    (call_stack->top >= call_stack->capacity - 1)
+#endif
+
+// Fewer than n values: the reference handler reports the underflow. The
+// unchecked handler follows
+#define CHECK_DEPTH(n, handler)                         \
+        if (UNLIKELY(DEPTH() < (n))) { SLOW(handler); DISPATCH(); }
+
+// Push, or let the reference handler grow the stack
+#define PUSH(value, handler) do {                       \
+        if (UNLIKELY(STACK_FULL())) SLOW(handler);      \
+        else PUSH_FAST(value);                          \
+    } while (0)
+
+// Taken flow control, ip past the branch. pc holds the start of the
+// straight run in between: the run is charged to fuel here, and the
+// sampler (sample.c) sees which block is running. run_sp is where the
+// stack stood when it began, which guard.c needs to tell which of its
+// instructions overflowed
+#define CHARGE()            (interpreter->fuel -= (ip - code) - interpreter->pc)
+#define BRANCH(target) do {                             \
+        const int target_ = (int)(target);              \
+        CHARGE();                                       \
+        interpreter->pc = target_;                      \
+        interpreter->run_sp = sp;                       \
+        ip = code + target_;                            \
+        if (UNLIKELY(interpreter->fuel < 0)) goto out_of_fuel; \
+    } while (0)
+
+// Hand the current instruction to its reference handler
+#define SLOW(handler) do {                              \
+        SPILL();                                        \
+        CHARGE();                                       \
+        interpreter->pc = (int)(ip - code);             \
+        handler(interpreter, op->operand);              \
+        RELOAD();                                       \
+        if (!interpreter->running) goto halt;           \
+        ip = code + interpreter->pc;                    \
+        interpreter->run_sp = sp;                       \
+    } while (0)
+
+void interpreter_run_threaded(Interpreter* interpreter) {
+    const Op *code = interpreter->program.code;
+    const Op *ip = code + interpreter->pc;
+    const Op *op;
+    Stack *stack = interpreter->stack;
+    Stack *call_stack = interpreter->call_stack;
+    const Heap *heap = &interpreter->heap;
+    Value *data;
+    Value *sp;
+#if WS_TOS_CACHE
+    Value tos;
+#endif
+
+    RELOAD();
+    interpreter->run_sp = sp;
+
+#ifdef WS_ENGINE_THREADED
+    static void *const dispatch_table[OP_COUNT] = {
+        [OP_PUSH]       = &&L_OP_PUSH,
+        [OP_PUSH_CONST] = &&L_OP_PUSH_CONST,
+        [OP_COPY]       = &&L_OP_COPY,
+        [OP_SLIDE]      = &&L_OP_SLIDE,
+        [OP_DUP]        = &&L_OP_DUP,
+        [OP_SWAP]       = &&L_OP_SWAP,
+        [OP_DISCARD]    = &&L_OP_DISCARD,
+        [OP_ADD]        = &&L_OP_ADD,
+        [OP_SUB]        = &&L_OP_SUB,
+        [OP_MUL]        = &&L_OP_MUL,
+        [OP_DIV]        = &&L_OP_DIV,
+        [OP_MOD]        = &&L_OP_MOD,
+        [OP_STORE]      = &&L_OP_STORE,
+        [OP_RETRIEVE]   = &&L_OP_RETRIEVE,
+        [OP_OUT_CHAR]   = &&L_OP_OUT_CHAR,
+        [OP_OUT_NUM]    = &&L_OP_OUT_NUM,
+        [OP_IN_CHAR]    = &&L_OP_IN_CHAR,
+        [OP_IN_NUM]     = &&L_OP_IN_NUM,
+        [OP_CALL]       = &&L_OP_CALL,
+        [OP_JUMP]       = &&L_OP_JUMP,
+        [OP_JZ]         = &&L_OP_JZ,
+        [OP_JN]         = &&L_OP_JN,
+        [OP_RET]        = &&L_OP_RET,
+        [OP_END]        = &&L_OP_END,
+
+        [OP_PUSH_ADD]           = &&L_OP_PUSH_ADD,
+        [OP_PUSH_SUB]           = &&L_OP_PUSH_SUB,
+        [OP_PUSH_MUL]           = &&L_OP_PUSH_MUL,
+        [OP_PUSH_STORE]         = &&L_OP_PUSH_STORE,
+        [OP_PUSH_PUSH_STORE]    = &&L_OP_PUSH_PUSH_STORE,
+        [OP_PUSH_RETRIEVE]      = &&L_OP_PUSH_RETRIEVE,
+        [OP_PUSH_OUT_CHAR]      = &&L_OP_PUSH_OUT_CHAR,
+        [OP_DUP_JZ]             = &&L_OP_DUP_JZ,
+        [OP_DUP_JN]             = &&L_OP_DUP_JN,
+        [OP_SUB_JZ]             = &&L_OP_SUB_JZ,
+        [OP_SWAP_SUB]           = &&L_OP_SWAP_SUB,
+        [OP_PUSH_SUB_DUP_JN]    = &&L_OP_PUSH_SUB_DUP_JN,
+
+        [OP_COPY_UNCHECKED]             = &&L_OP_COPY_UNCHECKED,
+        [OP_SLIDE_UNCHECKED]            = &&L_OP_SLIDE_UNCHECKED,
+        [OP_DUP_UNCHECKED]              = &&L_OP_DUP_UNCHECKED,
+        [OP_SWAP_UNCHECKED]             = &&L_OP_SWAP_UNCHECKED,
+        [OP_DISCARD_UNCHECKED]          = &&L_OP_DISCARD_UNCHECKED,
+        [OP_ADD_UNCHECKED]              = &&L_OP_ADD_UNCHECKED,
+        [OP_SUB_UNCHECKED]              = &&L_OP_SUB_UNCHECKED,
+        [OP_MUL_UNCHECKED]              = &&L_OP_MUL_UNCHECKED,
+        [OP_DIV_UNCHECKED]              = &&L_OP_DIV_UNCHECKED,
+        [OP_MOD_UNCHECKED]              = &&L_OP_MOD_UNCHECKED,
+        [OP_STORE_UNCHECKED]            = &&L_OP_STORE_UNCHECKED,
+        [OP_RETRIEVE_UNCHECKED]         = &&L_OP_RETRIEVE_UNCHECKED,
+        [OP_JZ_UNCHECKED]               = &&L_OP_JZ_UNCHECKED,
+        [OP_JN_UNCHECKED]               = &&L_OP_JN_UNCHECKED,
+        [OP_PUSH_ADD_UNCHECKED]         = &&L_OP_PUSH_ADD_UNCHECKED,
+        [OP_PUSH_SUB_UNCHECKED]         = &&L_OP_PUSH_SUB_UNCHECKED,
+        [OP_PUSH_MUL_UNCHECKED]         = &&L_OP_PUSH_MUL_UNCHECKED,
+        [OP_PUSH_STORE_UNCHECKED]       = &&L_OP_PUSH_STORE_UNCHECKED,
+        [OP_DUP_JZ_UNCHECKED]           = &&L_OP_DUP_JZ_UNCHECKED,
+        [OP_DUP_JN_UNCHECKED]           = &&L_OP_DUP_JN_UNCHECKED,
+        [OP_SUB_JZ_UNCHECKED]           = &&L_OP_SUB_JZ_UNCHECKED,
+        [OP_SWAP_SUB_UNCHECKED]         = &&L_OP_SWAP_SUB_UNCHECKED,
+        [OP_PUSH_SUB_DUP_JN_UNCHECKED]  = &&L_OP_PUSH_SUB_DUP_JN_UNCHECKED,
+    };
+
+    DISPATCH();
+#else
+    for (;;) {
+        op = ip++;
+        switch (op->opcode) {
+#endif
+
+    // STACK
+
+    TARGET(OP_PUSH) {
+        PUSH(SMALL(op->operand), instr_push);
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_CONST) {
+        PUSH(interpreter->program.constants[op->operand], instr_push_const);
+        DISPATCH();
+    }
+
+    TARGET(OP_COPY)
+        if (UNLIKELY(op->operand < 0 || DEPTH() <= op->operand)) { SLOW(instr_copy); DISPATCH(); }
+    UNCHECKED_TARGET(OP_COPY_UNCHECKED) {
+        PUSH(AT(op->operand), instr_copy);
+        DISPATCH();
+    }
+
+    TARGET(OP_SLIDE)
+        if (UNLIKELY(op->operand < 0 || DEPTH() <= op->operand)) { SLOW(instr_slide); DISPATCH(); }
+    UNCHECKED_TARGET(OP_SLIDE_UNCHECKED) {
+        const Value top = TOS;
+        sp -= op->operand;
+        TOS = top;
+        DISPATCH();
+    }
+
+    TARGET(OP_DUP) CHECK_DEPTH(1, instr_duplicate)
+    UNCHECKED_TARGET(OP_DUP_UNCHECKED) {
+        PUSH(TOS, instr_duplicate);
+        DISPATCH();
+    }
+
+    TARGET(OP_SWAP) CHECK_DEPTH(2, instr_swap)
+    UNCHECKED_TARGET(OP_SWAP_UNCHECKED) {
+        const Value a = TOS;
+        TOS = NOS;
+        NOS = a;
+        DISPATCH();
+    }
+
+    TARGET(OP_DISCARD) CHECK_DEPTH(1, instr_discard)
+    UNCHECKED_TARGET(OP_DISCARD_UNCHECKED) {
+        DROP(1);
+        DISPATCH();
+    }
+
+    // ARITHMETIC
+
+    TARGET(OP_ADD) CHECK_DEPTH(2, instr_add)
+    UNCHECKED_TARGET(OP_ADD_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(!BOTH_SMALL(NOS, TOS) || VALUE_ADD_OVERFLOW(NOS, TOS, &result))) SLOW(instr_add);
+        else {
+            DROP(1);
+            TOS = result;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_SUB) CHECK_DEPTH(2, instr_sub)
+    UNCHECKED_TARGET(OP_SUB_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(!BOTH_SMALL(NOS, TOS) || VALUE_SUB_OVERFLOW(NOS, TOS, &result))) SLOW(instr_sub);
+        else {
+            DROP(1);
+            TOS = result;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_MUL) CHECK_DEPTH(2, instr_mul)
+    UNCHECKED_TARGET(OP_MUL_UNCHECKED) {
+        Value result;
+        // Untagged times tagged gives the tagged product
+        if (UNLIKELY(!BOTH_SMALL(NOS, TOS) || VALUE_MUL_OVERFLOW(value_small(NOS), TOS, &result))) SLOW(instr_mul);
+        else {
+            DROP(1);
+            TOS = result;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_DIV) CHECK_DEPTH(2, instr_div)
+    UNCHECKED_TARGET(OP_DIV_UNCHECKED) {
+        Value result;
+        // Only SMALL_MIN / -1 leaves the small range
+        if (UNLIKELY(!BOTH_SMALL(NOS, TOS) || TOS == 0 ||
+                     (NOS == SMALL(VALUE_SMALL_MIN) && TOS == SMALL(-1)))) SLOW(instr_div);
+        else {
+            result = SMALL(value_small(NOS) / value_small(TOS));
+            DROP(1);
+            TOS = result;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_MOD) CHECK_DEPTH(2, instr_mod)
+    UNCHECKED_TARGET(OP_MOD_UNCHECKED) {
+        Value result;
+        // (2a) % (2b) == 2 (a % b), so the remainder needs no untagging
+        if (UNLIKELY(!BOTH_SMALL(NOS, TOS) || TOS == 0)) SLOW(instr_mod);
+        else {
+            result = NOS % TOS;
+            DROP(1);
+            TOS = result;
+        }
+        DISPATCH();
+    }
+
+    // HEAP
+
+    TARGET(OP_STORE) CHECK_DEPTH(2, instr_heap_store)
+    UNCHECKED_TARGET(OP_STORE_UNCHECKED) {
+        Value *cell;
+        if (UNLIKELY((cell = CELL(NOS)) == NULL)) SLOW(instr_heap_store);
+        else {
+            *cell = TOS;
+            DROP(2);
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_RETRIEVE) CHECK_DEPTH(1, instr_heap_retrieve)
+    UNCHECKED_TARGET(OP_RETRIEVE_UNCHECKED) {
+        const Value *cell;
+        if (UNLIKELY((cell = CELL(TOS)) == NULL)) SLOW(instr_heap_retrieve);
+        else TOS = *cell;
+        DISPATCH();
+    }
+
+    // I/O
+
+    TARGET(OP_OUT_CHAR) {
+        SLOW(instr_out_char);
+        DISPATCH();
+    }
+
+    TARGET(OP_OUT_NUM) {
+        SLOW(instr_out_num);
+        DISPATCH();
+    }
+
+    TARGET(OP_IN_CHAR) {
+        SLOW(instr_in_char);
+        DISPATCH();
+    }
+
+    TARGET(OP_IN_NUM) {
+        SLOW(instr_in_num);
+        DISPATCH();
+    }
+
+    // FLOW
+
+    TARGET(OP_CALL) {
+        if (UNLIKELY(op->operand < 0 || CALLS_FULL())) SLOW(instr_call_subroutine);
+        else {
+            call_stack->data[++call_stack->top] = ip - code;
+            BRANCH(op->operand);
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_JUMP) {
+        if (UNLIKELY(op->operand < 0)) SLOW(instr_jump);
+        else BRANCH(op->operand);
+        DISPATCH();
+    }
+
+    TARGET(OP_JZ) CHECK_DEPTH(1, instr_jump_if_zero)
+    UNCHECKED_TARGET(OP_JZ_UNCHECKED) {
+        if (UNLIKELY(op->operand < 0)) SLOW(instr_jump_if_zero);
+        else {
+            const Value value = TOS;
+            DROP(1);
+            if (value == SMALL(0)) BRANCH(op->operand);
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_JN) CHECK_DEPTH(1, instr_jump_if_neg)
+    UNCHECKED_TARGET(OP_JN_UNCHECKED) {
+        if (UNLIKELY(op->operand < 0)) SLOW(instr_jump_if_neg);
+        else {
+            const Value value = TOS;
+            DROP(1);
+            if (value_is_negative(value)) BRANCH(op->operand);
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_RET) {
+        if (UNLIKELY(call_stack->top < 0)) SLOW(instr_ret);
+        else BRANCH(call_stack->data[call_stack->top--]);
+        DISPATCH();
+    }
+
+    TARGET(OP_END) {
+        goto halt;
+    }
+
+    // FUSED
+    // ip points at the second slot of the sequence. When the fast path does
+    // not apply, only the first instruction runs and the rest follow unfused.
+
+    TARGET(OP_PUSH_ADD) CHECK_DEPTH(1, instr_push)
+    UNCHECKED_TARGET(OP_PUSH_ADD_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(!value_is_small(TOS) || VALUE_ADD_OVERFLOW(TOS, SMALL(op->operand), &result))) SLOW(instr_push);
+        else {
+            TOS = result;
+            ip += 1;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_SUB) CHECK_DEPTH(1, instr_push)
+    UNCHECKED_TARGET(OP_PUSH_SUB_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(!value_is_small(TOS) || VALUE_SUB_OVERFLOW(TOS, SMALL(op->operand), &result))) SLOW(instr_push);
+        else {
+            TOS = result;
+            ip += 1;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_MUL) CHECK_DEPTH(1, instr_push)
+    UNCHECKED_TARGET(OP_PUSH_MUL_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(!value_is_small(TOS) || VALUE_MUL_OVERFLOW(TOS, (intptr_t)op->operand, &result))) SLOW(instr_push);
+        else {
+            TOS = result;
+            ip += 1;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_STORE) CHECK_DEPTH(1, instr_push)
+    UNCHECKED_TARGET(OP_PUSH_STORE_UNCHECKED) {
+        Value *cell;
+        if (UNLIKELY((cell = CELL(TOS)) == NULL)) SLOW(instr_push);
+        else {
+            *cell = SMALL(op->operand);
+            DROP(1);
+            ip += 1;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_PUSH_STORE) {
+        Value *cell = CELL_AT(op->operand);
+        if (UNLIKELY(cell == NULL)) SLOW(instr_push);
+        else {
+            *cell = SMALL(ip[0].operand);
+            ip += 2;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_RETRIEVE) {
+        // A full stack too takes the push alone, the retrieve runs next
+        const Value *cell = CELL_AT(op->operand);
+        if (UNLIKELY(cell == NULL || STACK_FULL())) SLOW(instr_push);
+        else {
+            PUSH_FAST(*cell);
+            ip += 1;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_OUT_CHAR) {
+        io_write_char(interpreter, op->operand);
+        ip += 1;
+        DISPATCH();
+    }
+
+    TARGET(OP_DUP_JZ) CHECK_DEPTH(1, instr_duplicate)
+    UNCHECKED_TARGET(OP_DUP_JZ_UNCHECKED) {
+        if (UNLIKELY(ip[0].operand < 0)) SLOW(instr_duplicate);
+        else if (TOS == SMALL(0)) { ip += 1; BRANCH(ip[-1].operand); }
+        else ip += 1;
+        DISPATCH();
+    }
+
+    TARGET(OP_DUP_JN) CHECK_DEPTH(1, instr_duplicate)
+    UNCHECKED_TARGET(OP_DUP_JN_UNCHECKED) {
+        if (UNLIKELY(ip[0].operand < 0)) SLOW(instr_duplicate);
+        else if (value_is_negative(TOS)) { ip += 1; BRANCH(ip[-1].operand); }
+        else ip += 1;
+        DISPATCH();
+    }
+
+    TARGET(OP_SUB_JZ) CHECK_DEPTH(2, instr_sub)
+    UNCHECKED_TARGET(OP_SUB_JZ_UNCHECKED) {
+        // Small values are equal exactly when their difference is zero
+        if (UNLIKELY(ip[0].operand < 0 || !BOTH_SMALL(NOS, TOS))) SLOW(instr_sub);
+        else {
+            const bool equal = NOS == TOS;
+            DROP(2);
+            ip += 1;
+            if (equal) BRANCH(ip[-1].operand);
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_SWAP_SUB) CHECK_DEPTH(2, instr_swap)
+    UNCHECKED_TARGET(OP_SWAP_SUB_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(!BOTH_SMALL(NOS, TOS) || VALUE_SUB_OVERFLOW(TOS, NOS, &result))) SLOW(instr_swap);
+        else {
+            DROP(1);
+            TOS = result;
+            ip += 1;
+        }
+        DISPATCH();
+    }
+
+    TARGET(OP_PUSH_SUB_DUP_JN) CHECK_DEPTH(1, instr_push)
+    UNCHECKED_TARGET(OP_PUSH_SUB_DUP_JN_UNCHECKED) {
+        Value result;
+        if (UNLIKELY(ip[2].operand < 0 || !value_is_small(TOS) ||
+                     VALUE_SUB_OVERFLOW(TOS, SMALL(op->operand), &result))) SLOW(instr_push);
+        else {
+            TOS = result;
+            ip += 3;
+            if (TOS < 0) BRANCH(ip[-1].operand);
+        }
+        DISPATCH();
+    }
+
+#ifndef WS_ENGINE_THREADED
+        default:
+            goto halt;
+        }
+    }
+#endif
+
+halt:
+    SPILL();
+    CHARGE();
+    interpreter->pc = (int)(ip - code);
+    interpreter->running = false;
+    return;
+
+out_of_fuel:
+    // Still running, from pc on
+    SPILL();
+}
@@ -0,0 +1,599 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#include "value.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Collections never run more often than every BIG_GC_MIN new BigInts
+#define BIG_GC_MIN 4096
+
+// Decimal conversion works on chunks of 9 digits
+#define DECIMAL_BASE 1000000000u
+#define DECIMAL_DIGITS 9
+
+// Read-only view of a magnitude, small values are expanded into local
+typedef struct {
+    int sign;
+    int length;
+    const uint32_t *limbs;
+    uint32_t local[2];
+} Magnitude;
+
+#ifndef __GNUC__
+bool value_add_overflow(const intptr_t a, const intptr_t b, intptr_t *result) {
+    if ((b > 0 && a > INTPTR_MAX - b) || (b < 0 && a < INTPTR_MIN - b)) return true;
+    *result = a + b;
+    return false;
+}
+
+bool value_sub_overflow(const intptr_t a, const intptr_t b, intptr_t *result) {
+    if ((b < 0 && a > INTPTR_MAX + b) || (b > 0 && a < INTPTR_MIN + b)) return true;
+    *result = a - b;
+    return false;
+}
+
+bool value_mul_overflow(const intptr_t a, const intptr_t b, intptr_t *result) {
+    if (a > 0) {
+        if (b > 0 ? a > INTPTR_MAX / b : b < INTPTR_MIN / a) return true;
+    } else {
+        if (b > 0 ? a < INTPTR_MIN / b : (a != 0 && b < INTPTR_MAX / a)) return true;
+    }
+    *result = a * b;
+    return false;
+}
+#endif
+
+// BIGINT STORAGE
+
+void bigpool_init(BigPool *pool) {
+    pool->all = NULL;
+    pool->count = 0;
+    pool->threshold = BIG_GC_MIN;
+}
+
+void bigpool_free(BigPool *pool) {
+    BigInt *big = pool->all;
+    while (big != NULL) {
+        BigInt *next = big->next;
+        free(big);
+        big = next;
+    }
+    bigpool_init(pool);
+}
+
+void bigpool_mark(const Value v) {
+    if (!value_is_small(v)) {
+        value_big(v)->marked = true;
+    }
+}
+
+// Free every BigInt that was not marked since the last sweep
+void bigpool_sweep(BigPool *pool) {
+    BigInt **link = &pool->all;
+    size_t live = 0;
+
+    while (*link != NULL) {
+        BigInt *big = *link;
+        if (big->marked) {
+            big->marked = false;
+            link = &big->next;
+            live++;
+        } else {
+            *link = big->next;
+            free(big);
+        }
+    }
+
+    pool->count = live;
+    pool->threshold = live * 2 > BIG_GC_MIN ? live * 2 : BIG_GC_MIN;
+}
+
+static BigInt* big_new(const int length) {
+    BigInt *big = malloc(sizeof(BigInt) + sizeof(uint32_t) * (length > 0 ? length : 1));
+    if (big == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+
+    big->next = NULL;
+    big->sign = 1;
+    big->length = length;
+    big->marked = false;
+    memset(big->limbs, 0, sizeof(uint32_t) * length);
+    return big;
+}
+
+// Trim, demote to a small value when it fits, otherwise hand to the pool
+// (constants are created without one and live as long as the program)
+static Value big_finish(BigPool *pool, BigInt *big) {
+    while (big->length > 0 && big->limbs[big->length - 1] == 0) {
+        big->length--;
+    }
+
+    if (big->length * 32 <= 64) {
+        uint64_t magnitude = 0;
+        for (int i = big->length - 1; i >= 0; i--) {
+            magnitude = (magnitude << 32) | big->limbs[i];
+        }
+
+        const uint64_t limit = (uint64_t)VALUE_SMALL_MAX + (big->sign < 0 ? 1 : 0);
+        if (magnitude <= limit) {
+            const intptr_t n = big->sign < 0 ? (intptr_t)(0 - magnitude) : (intptr_t)magnitude;
+            free(big);
+            return value_from_small(n);
+        }
+    }
+
+    if (pool != NULL) {
+        big->next = pool->all;
+        pool->all = big;
+        pool->count++;
+    }
+
+    return (Value)big + 1;
+}
+
+void value_free_constant(const Value v) {
+    if (!value_is_small(v)) {
+        free(value_big(v));
+    }
+}
+
+static void magnitude_of(const Value v, Magnitude *m) {
+    if (!value_is_small(v)) {
+        const BigInt *big = value_big(v);
+        m->sign = big->sign;
+        m->length = big->length;
+        m->limbs = big->limbs;
+        return;
+    }
+
+    const intptr_t n = value_small(v);
+    const uint64_t magnitude = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+    m->sign = n < 0 ? -1 : 1;
+    m->local[0] = (uint32_t)magnitude;
+    m->local[1] = (uint32_t)(magnitude >> 32);
+    m->length = m->local[1] ? 2 : (m->local[0] ? 1 : 0);
+    m->limbs = m->local;
+}
+
+// MAGNITUDE ARITHMETIC
+
+static int mag_cmp(const Magnitude *a, const Magnitude *b) {
+    if (a->length != b->length) return a->length < b->length ? -1 : 1;
+
+    for (int i = a->length - 1; i >= 0; i--) {
+        if (a->limbs[i] != b->limbs[i]) return a->limbs[i] < b->limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static BigInt* mag_add(const Magnitude *a, const Magnitude *b) {
+    const int length = (a->length > b->length ? a->length : b->length) + 1;
+    BigInt *result = big_new(length);
+    uint64_t carry = 0;
+
+    for (int i = 0; i < length; i++) {
+        uint64_t sum = carry;
+        if (i < a->length) sum += a->limbs[i];
+        if (i < b->length) sum += b->limbs[i];
+        result->limbs[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+
+    return result;
+}
+
+// |a| - |b|, requires |a| >= |b|
+static BigInt* mag_sub(const Magnitude *a, const Magnitude *b) {
+    BigInt *result = big_new(a->length);
+    int64_t borrow = 0;
+
+    for (int i = 0; i < a->length; i++) {
+        int64_t diff = (int64_t)a->limbs[i] - borrow - (i < b->length ? (int64_t)b->limbs[i] : 0);
+        borrow = diff < 0;
+        if (diff < 0) diff += (int64_t)1 << 32;
+        result->limbs[i] = (uint32_t)diff;
+    }
+
+    return result;
+}
+
+static BigInt* mag_mul(const Magnitude *a, const Magnitude *b) {
+    BigInt *result = big_new(a->length + b->length);
+
+    for (int i = 0; i < a->length; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; j < b->length; j++) {
+            const uint64_t t = (uint64_t)a->limbs[i] * b->limbs[j] + result->limbs[i + j] + carry;
+            result->limbs[i + j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        result->limbs[i + b->length] = (uint32_t)carry;
+    }
+
+    return result;
+}
+
+static int clz32(uint32_t x) {
+    int n = 0;
+    while ((x & 0x80000000u) == 0) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+}
+
+// Knuth's algorithm D. Requires |u| >= |v| and v non-zero; q gets
+// u->length - v->length + 1 limbs and r gets v->length limbs
+static void mag_divmod(const Magnitude *u, const Magnitude *v, BigInt *q, BigInt *r) {
+    const int m = u->length;
+    const int n = v->length;
+
+    if (n == 1) {
+        const uint32_t d = v->limbs[0];
+        uint64_t rem = 0;
+        for (int i = m - 1; i >= 0; i--) {
+            const uint64_t cur = (rem << 32) | u->limbs[i];
+            q->limbs[i] = (uint32_t)(cur / d);
+            rem = cur % d;
+        }
+        r->limbs[0] = (uint32_t)rem;
+        return;
+    }
+
+    // Normalize so the top limb of the divisor has its high bit set
+    const int s = clz32(v->limbs[n - 1]);
+    uint32_t *vn = malloc(sizeof(uint32_t) * n);
+    uint32_t *un = malloc(sizeof(uint32_t) * (m + 1));
+    if (vn == NULL || un == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = n - 1; i > 0; i--) {
+        vn[i] = (v->limbs[i] << s) | (uint32_t)((uint64_t)v->limbs[i - 1] >> (32 - s));
+    }
+    vn[0] = v->limbs[0] << s;
+
+    un[m] = (uint32_t)((uint64_t)u->limbs[m - 1] >> (32 - s));
+    for (int i = m - 1; i > 0; i--) {
+        un[i] = (u->limbs[i] << s) | (uint32_t)((uint64_t)u->limbs[i - 1] >> (32 - s));
+    }
+    un[0] = u->limbs[0] << s;
+
+    for (int j = m - n; j >= 0; j--) {
+        const uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+        uint64_t qhat = num / vn[n - 1];
+        uint64_t rhat = num % vn[n - 1];
+
+        while (qhat >> 32 || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+            qhat--;
+            rhat += vn[n - 1];
+            if (rhat >> 32) break;
+        }
+
+        // Multiply and subtract
+        int64_t k = 0;
+        int64_t t;
+        for (int i = 0; i < n; i++) {
+            const uint64_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - k - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + j] = (uint32_t)t;
+            k = (int64_t)(p >> 32) - (t >> 32);
+        }
+        t = (int64_t)un[j + n] - k;
+        un[j + n] = (uint32_t)t;
+
+        q->limbs[j] = (uint32_t)qhat;
+
+        // Subtracted too much, add one divisor back
+        if (t < 0) {
+            q->limbs[j]--;
+            uint64_t carry = 0;
+            for (int i = 0; i < n; i++) {
+                const uint64_t sum = (uint64_t)un[i + j] + vn[i] + carry;
+                un[i + j] = (uint32_t)sum;
+                carry = sum >> 32;
+            }
+            un[j + n] += (uint32_t)carry;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        r->limbs[i] = (un[i] >> s) | (uint32_t)((uint64_t)un[i + 1] << (32 - s));
+    }
+
+    free(vn);
+    free(un);
+}
+
+// VALUE ARITHMETIC (slow paths, small operands are handled by the callers)
+
+static Value value_add_signed(BigPool *pool, const Magnitude *a, const Magnitude *b) {
+    BigInt *result;
+
+    if (a->sign == b->sign) {
+        result = mag_add(a, b);
+        result->sign = a->sign;
+    } else if (mag_cmp(a, b) >= 0) {
+        result = mag_sub(a, b);
+        result->sign = a->sign;
+    } else {
+        result = mag_sub(b, a);
+        result->sign = b->sign;
+    }
+
+    return big_finish(pool, result);
+}
+
+Value value_add(BigPool *pool, const Value a, const Value b) {
+    intptr_t sum;
+    if (value_is_small(a) && value_is_small(b) && !VALUE_ADD_OVERFLOW(a, b, &sum)) {
+        return sum;
+    }
+
+    Magnitude ma, mb;
+    magnitude_of(a, &ma);
+    magnitude_of(b, &mb);
+    return value_add_signed(pool, &ma, &mb);
+}
+
+Value value_sub(BigPool *pool, const Value a, const Value b) {
+    intptr_t diff;
+    if (value_is_small(a) && value_is_small(b) && !VALUE_SUB_OVERFLOW(a, b, &diff)) {
+        return diff;
+    }
+
+    Magnitude ma, mb;
+    magnitude_of(a, &ma);
+    magnitude_of(b, &mb);
+    mb.sign = -mb.sign;
+    return value_add_signed(pool, &ma, &mb);
+}
+
+Value value_mul(BigPool *pool, const Value a, const Value b) {
+    intptr_t product;
+    if (value_is_small(a) && value_is_small(b) && !VALUE_MUL_OVERFLOW(value_small(a), b, &product)) {
+        return product;
+    }
+
+    Magnitude ma, mb;
+    magnitude_of(a, &ma);
+    magnitude_of(b, &mb);
+
+    BigInt *result = mag_mul(&ma, &mb);
+    result->sign = ma.sign * mb.sign;
+    return big_finish(pool, result);
+}
+
+// Truncating division like C: the quotient rounds toward zero and the
+// remainder takes the sign of the dividend. b must not be zero
+static void value_divmod(BigPool *pool, const Value a, const Value b, Value *quotient, Value *remainder) {
+    Magnitude ma, mb;
+    magnitude_of(a, &ma);
+    magnitude_of(b, &mb);
+
+    if (mag_cmp(&ma, &mb) < 0) {
+        if (quotient) *quotient = value_from_small(0);
+        if (remainder) *remainder = a;
+        return;
+    }
+
+    BigInt *q = big_new(ma.length - mb.length + 1);
+    BigInt *r = big_new(mb.length);
+    mag_divmod(&ma, &mb, q, r);
+    q->sign = ma.sign * mb.sign;
+    r->sign = ma.sign;
+
+    if (quotient) *quotient = big_finish(pool, q);
+    else free(q);
+
+    if (remainder) *remainder = big_finish(pool, r);
+    else free(r);
+}
+
+Value value_div(BigPool *pool, const Value a, const Value b) {
+    if (value_is_small(a) && value_is_small(b)) {
+        const intptr_t q = value_small(a) / value_small(b);
+        if (q >= VALUE_SMALL_MIN && q <= VALUE_SMALL_MAX) return value_from_small(q);
+    }
+
+    Value q;
+    value_divmod(pool, a, b, &q, NULL);
+    return q;
+}
+
+Value value_mod(BigPool *pool, const Value a, const Value b) {
+    if (value_is_small(a) && value_is_small(b)) {
+        return value_from_small(value_small(a) % value_small(b));
+    }
+
+    Value r;
+    value_divmod(pool, a, b, NULL, &r);
+    return r;
+}
+
+// CONVERSIONS
+
+Value value_from_int64(BigPool *pool, const int64_t n) {
+    if (n >= VALUE_SMALL_MIN && n <= VALUE_SMALL_MAX) {
+        return value_from_small((intptr_t)n);
+    }
+
+    const uint64_t magnitude = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+    BigInt *big = big_new(2);
+    big->sign = n < 0 ? -1 : 1;
+    big->limbs[0] = (uint32_t)magnitude;
+    big->limbs[1] = (uint32_t)(magnitude >> 32);
+    return big_finish(pool, big);
+}
+
+// bits are '0'/'1' characters, most significant first
+Value value_from_bits(BigPool *pool, const int sign, const char *bits, const int length) {
+    BigInt *big = big_new((length + 31) / 32);
+    big->sign = sign < 0 ? -1 : 1;
+
+    for (int i = 0; i < length; i++) {
+        if (bits[i] == '1') {
+            const int bit = length - 1 - i;
+            big->limbs[bit / 32] |= 1u << (bit % 32);
+        }
+    }
+
+    return big_finish(pool, big);
+}
+
+// limbs least significant first, as in BigInt
+Value value_from_limbs(BigPool *pool, const int sign, const uint32_t *limbs, const int length) {
+    BigInt *big = big_new(length);
+    big->sign = sign < 0 ? -1 : 1;
+    memcpy(big->limbs, limbs, sizeof(uint32_t) * length);
+    return big_finish(pool, big);
+}
+
+// digits are '0'..'9' characters, most significant first
+Value value_from_decimal(BigPool *pool, const int sign, const char *digits, const int length) {
+    // Each 9-digit chunk adds at most 30 bits
+    BigInt *big = big_new(length / DECIMAL_DIGITS * 30 / 32 + 2);
+    big->sign = sign < 0 ? -1 : 1;
+    int used = 0;
+
+    for (int i = 0; i < length;) {
+        uint32_t chunk = 0;
+        uint32_t scale = 1;
+        for (int k = 0; k < DECIMAL_DIGITS && i < length; k++, i++) {
+            chunk = chunk * 10 + (uint32_t)(digits[i] - '0');
+            scale *= 10;
+        }
+
+        uint64_t carry = chunk;
+        for (int j = 0; j < used; j++) {
+            const uint64_t t = (uint64_t)big->limbs[j] * scale + carry;
+            big->limbs[j] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        if (carry) big->limbs[used++] = (uint32_t)carry;
+    }
+
+    big->length = used;
+    return big_finish(pool, big);
+}
+
+// Character code for putchar, which keeps the low byte anyway
+int value_to_char(const Value v) {
+    if (value_is_small(v)) {
+        return (int)value_small(v);
+    }
+
+    const BigInt *big = value_big(v);
+    const uint32_t low = big->sign < 0 ? 0 - big->limbs[0] : big->limbs[0];
+    return (int)(low & 0xFF);
+}
+
+bool value_to_int(const Value v, int *out) {
+    if (!value_is_small(v)) return false;
+
+    const intptr_t n = value_small(v);
+    if (n < INT32_MIN || n > INT32_MAX) return false;
+
+    *out = (int)n;
+    return true;
+}
+
+// Upper bound of the characters value_format writes for v
+size_t value_format_size(const Value v) {
+    if (value_is_small(v)) {
+        return 21;
+    }
+
+    // 32 bits are less than 10 decimal digits, plus the sign
+    return (size_t)value_big(v)->length * 10 + 1;
+}
+
+// Decimal text of v, '-' first when negative, not terminated. Returns the
+// number of characters; out must hold value_format_size(v) of them
+size_t value_format(const Value v, char *out) {
+    char *p = out;
+
+    if (value_is_small(v)) {
+        const intptr_t n = value_small(v);
+        uint64_t magnitude = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+        char digits[20];
+        int count = 0;
+
+        do {
+            digits[count++] = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (n < 0) *p++ = '-';
+        while (count > 0) *p++ = digits[--count];
+        return (size_t)(p - out);
+    }
+
+    // Split into base 10^9 chunks, least significant first
+    const BigInt *big = value_big(v);
+    uint32_t *work = malloc(sizeof(uint32_t) * big->length);
+    uint32_t *chunks = malloc(sizeof(uint32_t) * (big->length * 32 / 29 + 2));
+    if (work == NULL || chunks == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(work, big->limbs, sizeof(uint32_t) * big->length);
+    int length = big->length;
+    int count = 0;
+
+    // A BigInt is never zero, so there is at least one chunk
+    do {
+        uint64_t rem = 0;
+        for (int i = length - 1; i >= 0; i--) {
+            const uint64_t cur = (rem << 32) | work[i];
+            work[i] = (uint32_t)(cur / DECIMAL_BASE);
+            rem = cur % DECIMAL_BASE;
+        }
+        chunks[count++] = (uint32_t)rem;
+        while (length > 0 && work[length - 1] == 0) length--;
+    } while (length > 0);
+
+    if (big->sign < 0) *p++ = '-';
+
+    // Leading chunk without padding, the others with exactly 9 digits
+    uint32_t top = chunks[count - 1];
+    char digits[DECIMAL_DIGITS];
+    int width = 0;
+    do {
+        digits[width++] = (char)('0' + top % 10);
+        top /= 10;
+    } while (top != 0);
+    while (width > 0) *p++ = digits[--width];
+
+    for (int i = count - 2; i >= 0; i--) {
+        uint32_t chunk = chunks[i];
+        for (int k = DECIMAL_DIGITS - 1; k >= 0; k--) {
+            p[k] = (char)('0' + chunk % 10);
+            chunk /= 10;
+        }
+        p += DECIMAL_DIGITS;
+    }
+
+    free(work);
+    free(chunks);
+    return (size_t)(p - out);
+}
+
+void value_fprint(FILE *out, const Value v) {
+    char buffer[32];
+    const size_t size = value_format_size(v);
+    char *text = size <= sizeof(buffer) ? buffer : malloc(size);
+    if (text == NULL) {
+        perror("Error allocating memory");
+        exit(EXIT_FAILURE);
+    }
+
+    fwrite(text, 1, value_format(v, text), out);
+    if (text != buffer) free(text);
+}
@@ -0,0 +1,96 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Whitespace integers are unbounded. A Value is a machine word:
+ * - low bit 0: small integer n stored as n << 1, so tagged values can be
+ *   added, subtracted and compared without untagging
+ * - low bit 1: pointer to a BigInt (plus one)
+ * Results are always normalized: a BigInt never holds a value that fits
+ * in a small integer, so zero is always small. */
+typedef intptr_t Value;
+
+#define VALUE_SMALL_MIN (INTPTR_MIN >> 1)
+#define VALUE_SMALL_MAX (INTPTR_MAX >> 1)
+
+typedef struct BigInt {
+    struct BigInt *next;        // Next BigInt owned by the same pool
+    int sign;                   // 1 or -1
+    int length;                 // Limbs in use, the top one is non-zero
+    bool marked;                // Reachable in the current collection
+    uint32_t limbs[];           // Magnitude, least significant limb first
+} BigInt;
+
+// BigInts created while running, reclaimed by mark and sweep
+typedef struct {
+    BigInt *all;
+    size_t count;
+    size_t threshold;           // Collect once count reaches this
+} BigPool;
+
+// Overflow checked word arithmetic
+#ifdef __GNUC__
+    #define VALUE_ADD_OVERFLOW(a, b, r) __builtin_add_overflow(a, b, r)
+    #define VALUE_SUB_OVERFLOW(a, b, r) __builtin_sub_overflow(a, b, r)
+    #define VALUE_MUL_OVERFLOW(a, b, r) __builtin_mul_overflow(a, b, r)
+#else
+    #define VALUE_ADD_OVERFLOW(a, b, r) value_add_overflow(a, b, r)
+    #define VALUE_SUB_OVERFLOW(a, b, r) value_sub_overflow(a, b, r)
+    #define VALUE_MUL_OVERFLOW(a, b, r) value_mul_overflow(a, b, r)
+bool value_add_overflow(intptr_t a, intptr_t b, intptr_t *result);
+bool value_sub_overflow(intptr_t a, intptr_t b, intptr_t *result);
+bool value_mul_overflow(intptr_t a, intptr_t b, intptr_t *result);
+#endif
+
+static inline bool value_is_small(const Value v) {
+    return (v & 1) == 0;
+}
+
+static inline Value value_from_small(const intptr_t n) {
+    return (Value)((uintptr_t)n << 1);
+}
+
+static inline intptr_t value_small(const Value v) {
+    return v >> 1;
+}
+
+static inline BigInt* value_big(const Value v) {
+    return (BigInt *)(v - 1);
+}
+
+static inline bool value_is_negative(const Value v) {
+    return value_is_small(v) ? v < 0 : value_big(v)->sign < 0;
+}
+
+void bigpool_init(BigPool *pool);
+void bigpool_free(BigPool *pool);
+void bigpool_mark(Value v);
+void bigpool_sweep(BigPool *pool);
+
+Value value_from_int64(BigPool *pool, int64_t n);
+Value value_from_bits(BigPool *pool, int sign, const char *bits, int length);
+Value value_from_limbs(BigPool *pool, int sign, const uint32_t *limbs, int length);
+Value value_from_decimal(BigPool *pool, int sign, const char *digits, int length);
+void value_free_constant(Value v);
+
+Value value_add(BigPool *pool, Value a, Value b);
+Value value_sub(BigPool *pool, Value a, Value b);
+Value value_mul(BigPool *pool, Value a, Value b);
+Value value_div(BigPool *pool, Value a, Value b);
+Value value_mod(BigPool *pool, Value a, Value b);
+
+int value_to_char(Value v);
+bool value_to_int(Value v, int *out);
+size_t value_format_size(Value v);
+size_t value_format(Value v, char *out);
+void value_fprint(FILE *out, Value v);
+
+#endif //VALUE_H
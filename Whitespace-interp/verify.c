@@ -0,0 +1,302 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+// Static stack depth verification. A pass over the control flow graph finds
+// the fewest values the stack can hold on entry to each slot: slot 0 starts
+// empty, every instruction moves the depth by its pops and pushes, and the
+// least depth over all edges into a slot is what it can count on. Returns
+// are not matched to their calls; every call site continues with the least
+// depth of any reachable ret. An instruction that would underflow stops the
+// program, so the depth after it is that of a run where it did not.
+//
+// Slots whose check the result makes redundant get an unchecked opcode,
+// which the threaded loop, the JIT and --emit-c run without the test. Slots
+// no run reaches keep their checks.
+
+#include <stdlib.h>
+#include "verify.h"
+#include "instruction.h"
+#include "fusion.h"
+#include "jit.h"
+
+#define UNCHECKED_COUNT (sizeof(unchecked_table) / sizeof(unchecked_table[0]))
+
+// Depths are tracked up to this, deeper stacks count as this deep. Bounds
+// how often a slot can be revisited, and copy and slide further down keep
+// their check
+#define VERIFY_DEPTH_MAX 256
+
+#define UNREACHED (-1)
+
+typedef struct {
+    uint8_t checked;
+    uint8_t unchecked;
+    uint8_t depth;      // Values the fast path needs, 0 for operand + 1
+} Unchecked;
+
+static const Unchecked unchecked_table[] = {
+    {OP_COPY,               OP_COPY_UNCHECKED,              0},
+    {OP_SLIDE,              OP_SLIDE_UNCHECKED,             0},
+    {OP_DUP,                OP_DUP_UNCHECKED,               1},
+    {OP_SWAP,               OP_SWAP_UNCHECKED,              2},
+    {OP_DISCARD,            OP_DISCARD_UNCHECKED,           1},
+    {OP_ADD,                OP_ADD_UNCHECKED,               2},
+    {OP_SUB,                OP_SUB_UNCHECKED,               2},
+    {OP_MUL,                OP_MUL_UNCHECKED,               2},
+    {OP_DIV,                OP_DIV_UNCHECKED,               2},
+    {OP_MOD,                OP_MOD_UNCHECKED,               2},
+    {OP_STORE,              OP_STORE_UNCHECKED,             2},
+    {OP_RETRIEVE,           OP_RETRIEVE_UNCHECKED,          1},
+    {OP_JZ,                 OP_JZ_UNCHECKED,                1},
+    {OP_JN,                 OP_JN_UNCHECKED,                1},
+    // Fused ones by what the whole sequence needs on entry
+    {OP_PUSH_ADD,           OP_PUSH_ADD_UNCHECKED,          1},
+    {OP_PUSH_SUB,           OP_PUSH_SUB_UNCHECKED,          1},
+    {OP_PUSH_MUL,           OP_PUSH_MUL_UNCHECKED,          1},
+    {OP_PUSH_STORE,         OP_PUSH_STORE_UNCHECKED,        1},
+    {OP_DUP_JZ,             OP_DUP_JZ_UNCHECKED,            1},
+    {OP_DUP_JN,             OP_DUP_JN_UNCHECKED,            1},
+    {OP_SUB_JZ,             OP_SUB_JZ_UNCHECKED,            2},
+    {OP_SWAP_SUB,           OP_SWAP_SUB_UNCHECKED,          2},
+    {OP_PUSH_SUB_DUP_JN,    OP_PUSH_SUB_DUP_JN_UNCHECKED,   1},
+};
+
+typedef struct {
+    const Program *program;
+    int *depth;         // Least depth on entry to each slot, UNREACHED if none
+    int *pending;       // Slots whose successors need another look
+    int pending_count;
+    bool *queued;       // Slot is in pending
+    int *sites;         // Slots execution returns to
+    int site_count;
+    bool *site;         // Slot is in sites
+    int returns;        // Least depth at any reached ret, UNREACHED if none
+} Analysis;
+
+uint8_t verify_checked(const uint8_t opcode) {
+    for (size_t k = 0; k < UNCHECKED_COUNT; k++) {
+        if (unchecked_table[k].unchecked == opcode) return unchecked_table[k].checked;
+    }
+    return opcode;
+}
+
+// Values the fast path of a checked opcode needs, -1 if it has no unchecked
+// form or the operand always takes the slow path
+static int needed_depth(const Op *op, const Unchecked **entry) {
+    const uint8_t checked = verify_checked(op->opcode);
+
+    for (size_t k = 0; k < UNCHECKED_COUNT; k++) {
+        if (unchecked_table[k].checked != checked) continue;
+
+        *entry = &unchecked_table[k];
+        if (unchecked_table[k].depth > 0) return unchecked_table[k].depth;
+        return op->operand >= 0 && op->operand < VERIFY_DEPTH_MAX ? op->operand + 1 : -1;
+    }
+    return -1;
+}
+
+int verify_depth(const Op *op) {
+    const Unchecked *entry = NULL;
+    const int depth = needed_depth(op, &entry);
+    return entry != NULL && entry->unchecked == op->opcode ? depth : 0;
+}
+
+static void reach(Analysis *a, const int slot, int depth) {
+    if (slot < 0 || slot >= a->program->length) return;
+    if (depth > VERIFY_DEPTH_MAX) depth = VERIFY_DEPTH_MAX;
+    if (a->depth[slot] != UNREACHED && a->depth[slot] <= depth) return;
+
+    a->depth[slot] = depth;
+    if (!a->queued[slot]) {
+        a->queued[slot] = true;
+        a->pending[a->pending_count++] = slot;
+    }
+}
+
+static void add_site(Analysis *a, const int slot) {
+    if (slot < 0 || slot >= a->program->length || a->site[slot]) return;
+
+    a->site[slot] = true;
+    a->sites[a->site_count++] = slot;
+    if (a->returns != UNREACHED) reach(a, slot, a->returns);
+}
+
+static void add_return(Analysis *a, const int depth) {
+    if (a->returns != UNREACHED && a->returns <= depth) return;
+
+    a->returns = depth;
+    for (int n = 0; n < a->site_count; n++) {
+        reach(a, a->sites[n], depth);
+    }
+}
+
+// Push on the successors of slot what they get from it
+static void step(Analysis *a, const int slot) {
+    const Op *op = &a->program->code[slot];
+    const int n = op->operand;
+    const int in = a->depth[slot];
+    // Depth on entry in a run that gets past an instruction needing k values
+    #define AT_LEAST(k) (in > (k) ? in : (k))
+
+    switch (fusion_first(verify_checked(op->opcode))) {
+        case OP_PUSH:
+        case OP_PUSH_CONST:
+            reach(a, slot + 1, in + 1);
+            break;
+
+        case OP_COPY:
+            if (n >= 0) reach(a, slot + 1, AT_LEAST(n < VERIFY_DEPTH_MAX ? n + 1 : VERIFY_DEPTH_MAX) + 1);
+            break;
+
+        case OP_SLIDE: {
+            // Sliding more than is there leaves just the top
+            const int left = n > 0 ? in - n : in;
+            reach(a, slot + 1, left > 1 ? left : 1);
+            break;
+        }
+
+        case OP_DUP:
+            reach(a, slot + 1, AT_LEAST(1) + 1);
+            break;
+
+        case OP_SWAP:
+            reach(a, slot + 1, AT_LEAST(2));
+            break;
+
+        case OP_RETRIEVE:
+            reach(a, slot + 1, AT_LEAST(1));
+            break;
+
+        case OP_DISCARD:
+        case OP_OUT_CHAR:
+        case OP_OUT_NUM:
+        case OP_IN_CHAR:
+        case OP_IN_NUM:
+            reach(a, slot + 1, AT_LEAST(1) - 1);
+            break;
+
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+            reach(a, slot + 1, AT_LEAST(2) - 1);
+            break;
+
+        case OP_STORE:
+            reach(a, slot + 1, AT_LEAST(2) - 2);
+            break;
+
+        // Undefined labels (negative targets) stop the program
+        case OP_CALL:
+            if (n < 0) break;
+            add_site(a, slot + 1);
+            reach(a, n, in);
+            break;
+
+        case OP_JUMP:
+            if (n >= 0) reach(a, n, in);
+            break;
+
+        case OP_JZ:
+        case OP_JN:
+            if (n < 0) break;
+            reach(a, slot + 1, AT_LEAST(1) - 1);
+            reach(a, n, AT_LEAST(1) - 1);
+            break;
+
+        case OP_RET:
+            add_return(a, in);
+            break;
+
+        default:
+            break;
+    }
+    #undef AT_LEAST
+}
+
+static void analyse(Analysis *a, const Interpreter *interpreter) {
+    const int length = a->program->length;
+    a->returns = UNREACHED;
+    for (int i = 0; i < length; i++) {
+        a->depth[i] = UNREACHED;
+    }
+
+    reach(a, 0, 0);
+    const Stack *stack = interpreter->stack;
+    reach(a, interpreter->pc, stack->top + 1);
+    const Stack *calls = interpreter->call_stack;
+    for (int i = 0; i <= calls->top; i++) {
+        add_site(a, (int)calls->data[i]);
+    }
+
+    while (a->pending_count > 0) {
+        const int slot = a->pending[--a->pending_count];
+        a->queued[slot] = false;
+        step(a, slot);
+    }
+}
+
+void verify_program(Interpreter *interpreter) {
+    Program *program = &interpreter->program;
+    const int length = program->length;
+
+    Analysis a = {.program = program};
+    a.depth = malloc(length * sizeof(int));
+    a.pending = malloc(length * sizeof(int));
+    a.queued = calloc(length, sizeof(bool));
+    a.sites = malloc(length * sizeof(int));
+    a.site = calloc(length, sizeof(bool));
+
+    const bool analysed = length > 0 && a.depth != NULL && a.pending != NULL && a.queued != NULL &&
+                          a.sites != NULL && a.site != NULL;
+    if (analysed) analyse(&a, interpreter);
+
+    // Without the analysis everything stays checked. Slots are only written
+    // when they change, a mapped cache stays shared with the file
+    bool changed = false;
+    for (int i = 0; i < length; i++) {
+        Op *op = &program->code[i];
+        const Unchecked *entry = NULL;
+        const int needed = needed_depth(op, &entry);
+        if (entry == NULL) continue;
+
+        const bool safe = analysed && needed >= 0 && a.depth[i] != UNREACHED && a.depth[i] >= needed;
+        const uint8_t opcode = safe ? entry->unchecked : entry->checked;
+        if (op->opcode != opcode) {
+            op->opcode = opcode;
+            changed = true;
+        }
+    }
+
+    // Native code was built for the old opcodes
+    if (changed) {
+        jit_free(interpreter->jit_code);
+        interpreter->jit_code = NULL;
+    }
+
+    free(a.depth);
+    free(a.pending);
+    free(a.queued);
+    free(a.sites);
+    free(a.site);
+}
+
+// How many slots with an underflow check had it proven redundant
+void verify_report(FILE *out, const Program *program) {
+    int checks = 0;
+    int unchecked = 0;
+
+    for (int i = 0; i < program->length; i++) {
+        const Op *op = &program->code[i];
+        const Unchecked *entry = NULL;
+        needed_depth(op, &entry);
+        if (entry == NULL) continue;
+
+        checks++;
+        if (op->opcode == entry->unchecked) unchecked++;
+    }
+
+    fprintf(out, "Stack checks: %d of %d proven redundant\n", unchecked, checks);
+}
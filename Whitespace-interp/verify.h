@@ -0,0 +1,22 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdio.h>
+#include "interpreter.h"
+
+// Give every slot whose stack underflow check cannot fail its unchecked
+// opcode, and every other slot the checked one. Covers a run from the
+// start as well as one carrying on from the current pc, stacks and return
+// addresses (a restored checkpoint)
+void verify_program(Interpreter *interpreter);
+// Values an unchecked opcode may take as given, 0 for any other
+int verify_depth(const Op *op);
+// Checked opcode of an unchecked one, others map to themselves
+uint8_t verify_checked(uint8_t opcode);
+void verify_report(FILE *out, const Program *program);
+
+#endif //VERIFY_H
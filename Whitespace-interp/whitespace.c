@@ -0,0 +1,84 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#include "whitespace.h"
+#include "interpreter.h"
+#include "checkpoint.h"
+#include "optimize.h"
+
+WsInterpreter* ws_new(void) {
+    Interpreter *interpreter = interpreter_new();
+    if (interpreter == NULL) return NULL;
+
+    // The host decides when output is handed over, see ws_set_io
+    interpreter->output.policy = FLUSH_FULL;
+    // Nothing to run until ws_load
+    interpreter->running = false;
+    return interpreter;
+}
+
+void ws_delete(WsInterpreter *ws) {
+    interpreter_delete(ws);
+}
+
+void ws_set_io(WsInterpreter *ws, const WsIO *io) {
+    output_flush(&ws->output);
+
+    ws->input.read = io->read ? io->read : stream_read_stdin;
+    ws->input.user = io->user;
+    ws->output.write = io->write ? io->write : stream_write_stdout;
+    ws->output.user = io->user;
+    ws->error_write = io->error ? io->error : stream_write_stderr;
+    ws->error_user = io->user;
+}
+
+int ws_set_options(WsInterpreter *ws, const WsOptions *options) {
+    if (options->optimize < 0 || options->optimize > OPTIMIZE_MAX) return -1;
+
+    ws->fuse = options->fuse != 0;
+    ws->optimize = options->optimize;
+    ws->jit = options->jit != 0;
+    return 0;
+}
+
+int ws_load(WsInterpreter *ws, const char *source, const size_t length) {
+    if (interpreter_load(ws, source, length) != 0) {
+        ws->program.length = 0;
+        ws->running = false;
+        return -1;
+    }
+
+    interpreter_reset(ws);
+    return 0;
+}
+
+WsStatus ws_run(WsInterpreter *ws, const uint64_t budget) {
+    if (ws->program.length == 0) return WS_FAILED;
+
+    if (ws->running) {
+        if (budget == 0) interpreter_continue(ws);
+        else interpreter_step(ws, budget);
+    }
+
+    if (ws->running) return WS_PAUSED;
+    return ws->failed ? WS_FAILED : WS_DONE;
+}
+
+void ws_reset(WsInterpreter *ws) {
+    if (ws->program.length == 0) return;
+
+    interpreter_reset(ws);
+}
+
+int ws_checkpoint(WsInterpreter *ws, const char *path) {
+    if (ws->program.length == 0) return -1;
+
+    return checkpoint_save(ws, path);
+}
+
+int ws_restore(WsInterpreter *ws, const char *path) {
+    if (ws->program.length == 0) return -1;
+
+    return checkpoint_restore(ws, path);
+}
@@ -0,0 +1,92 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef WHITESPACE_H
+#define WHITESPACE_H
+
+// Embedding API of libwhitespace. An interpreter is independent of any
+// other, so several can run side by side on different threads; a single
+// one must not be used from two threads at once.
+//
+//     WsInterpreter *ws = ws_new();
+//     ws_set_io(ws, &(WsIO){my_read, my_write, NULL, my_context});
+//     if (ws_load(ws, source, length) == 0) {
+//         while (ws_run(ws, 100000) == WS_PAUSED) { ... }
+//     }
+//     ws_delete(ws);
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Interpreter WsInterpreter;
+
+typedef enum {
+    WS_DONE,            // The program ended
+    WS_PAUSED,          // The step budget ran out, ws_run carries on
+    WS_FAILED           // The program stopped on a runtime error, or nothing is loaded
+} WsStatus;
+
+// Program output and error messages: write size bytes of data, return the
+// number written
+typedef size_t (*WsWrite)(void *user, const char *data, size_t size);
+// Program input: read up to size bytes, return how many, 0 at the end of
+// input or -1 on an error. Called only when the program needs more input
+typedef ptrdiff_t (*WsRead)(void *user, char *buffer, size_t size);
+
+typedef struct {
+    WsRead read;        // NULL for stdin
+    WsWrite write;      // NULL for stdout
+    WsWrite error;      // NULL for stderr
+    void *user;         // Passed to all three
+} WsIO;
+
+typedef struct {
+    int fuse;           // Fuse common sequences into superinstructions, 1 by default
+    int optimize;       // Optimizer level from 0 (the default) to 2
+    int jit;            // Run as native code where supported, 0 by default
+} WsOptions;
+
+WsInterpreter* ws_new(void);
+void ws_delete(WsInterpreter *ws);
+
+// Replace the I/O of the interpreter. Output is buffered and handed to
+// write in blocks, at the latest when ws_run returns
+void ws_set_io(WsInterpreter *ws, const WsIO *io);
+
+// Replace the options of the interpreter. fuse and optimize apply from the
+// next ws_load, jit from the next ws_run. 0 on success, -1 if a value is
+// out of range, leaving the options as they were
+int ws_set_options(WsInterpreter *ws, const WsOptions *options);
+
+// Decode a program from memory (length bytes, no terminator needed) and
+// get ready to run it from the start. 0 on success, -1 if it does not
+// decode. Messages about the source go to the error writer of ws_set_io
+int ws_load(WsInterpreter *ws, const char *source, size_t length);
+
+// Run the loaded program. With a budget it stops after that many
+// instructions with WS_PAUSED, and the next call resumes where it left
+// off; 0 means no budget. Once the program stopped, further calls return
+// the same status until ws_reset or ws_load
+WsStatus ws_run(WsInterpreter *ws, uint64_t budget);
+
+// Clear stacks, heap and input state to run the loaded program again,
+// without decoding it again
+void ws_reset(WsInterpreter *ws);
+
+// Save the state of a paused program to a checkpoint file, 0 on success.
+// ws_restore continues from one: the same source must be loaded, then
+// ws_run resumes where the checkpoint was taken. -1 on errors, with the
+// message on stderr
+int ws_checkpoint(WsInterpreter *ws, const char *path);
+int ws_restore(WsInterpreter *ws, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //WHITESPACE_H
@@ -0,0 +1,246 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "x64.h"
+
+#define REX_W 0x08
+
+void x64_init(X64Buffer *buffer) {
+    buffer->bytes = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    buffer->failed = false;
+}
+
+void x64_free(X64Buffer *buffer) {
+    free(buffer->bytes);
+    x64_init(buffer);
+}
+
+void x64_byte(X64Buffer *buffer, const uint8_t byte) {
+    if (buffer->length == buffer->capacity) {
+        if (buffer->failed) return;
+
+        const size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        uint8_t *bytes = realloc(buffer->bytes, capacity);
+        if (bytes == NULL) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->bytes = bytes;
+        buffer->capacity = capacity;
+    }
+    buffer->bytes[buffer->length++] = byte;
+}
+
+void x64_u32(X64Buffer *buffer, const uint32_t value) {
+    for (int i = 0; i < 4; i++) x64_byte(buffer, (uint8_t)(value >> (8 * i)));
+}
+
+void x64_u64(X64Buffer *buffer, const uint64_t value) {
+    for (int i = 0; i < 8; i++) x64_byte(buffer, (uint8_t)(value >> (8 * i)));
+}
+
+// Point the rel32 field at offset `at` to `target`
+void x64_patch_rel32(X64Buffer *buffer, const size_t at, const size_t target) {
+    if (buffer->failed) return;
+
+    const int32_t rel = (int32_t)((int64_t)target - (int64_t)(at + 4));
+    memcpy(buffer->bytes + at, &rel, sizeof(rel));
+}
+
+// REX prefix, left out when it would be empty
+static void emit_rex(X64Buffer *buffer, const int w, const int reg, const int index, const int base) {
+    const int rex = (w ? REX_W : 0) | ((reg >> 3) & 1) << 2 | ((index >> 3) & 1) << 1 | ((base >> 3) & 1);
+    if (rex) x64_byte(buffer, (uint8_t)(0x40 | rex));
+}
+
+static void emit_rex_mem(X64Buffer *buffer, const int w, const int reg, const X64Mem m) {
+    emit_rex(buffer, w, reg, m.index == X64_NONE ? 0 : m.index, m.base);
+}
+
+static void emit_modrm_reg(X64Buffer *buffer, const int reg, const int rm) {
+    x64_byte(buffer, (uint8_t)(0xC0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+static void emit_modrm_mem(X64Buffer *buffer, const int reg, const X64Mem m) {
+    const int base = m.base & 7;
+    // rbp and r13 have no displacement-free form
+    const int mod = m.disp == 0 && base != 5 ? 0 : m.disp >= -128 && m.disp <= 127 ? 1 : 2;
+
+    // rsp and r12 as a base always need a SIB byte
+    if (m.index != X64_NONE || base == 4) {
+        const int scale = m.scale == 8 ? 3 : m.scale == 4 ? 2 : m.scale == 2 ? 1 : 0;
+        const int index = m.index == X64_NONE ? 4 : m.index & 7;
+        x64_byte(buffer, (uint8_t)(mod << 6 | (reg & 7) << 3 | 4));
+        x64_byte(buffer, (uint8_t)(scale << 6 | index << 3 | base));
+    } else {
+        x64_byte(buffer, (uint8_t)(mod << 6 | (reg & 7) << 3 | base));
+    }
+
+    if (mod == 1) x64_byte(buffer, (uint8_t)m.disp);
+    else if (mod == 2) x64_u32(buffer, (uint32_t)m.disp);
+}
+
+static void emit_rr(X64Buffer *buffer, const uint8_t opcode, const int reg, const int rm) {
+    emit_rex(buffer, 1, reg, 0, rm);
+    x64_byte(buffer, opcode);
+    emit_modrm_reg(buffer, reg, rm);
+}
+
+static void emit_rm(X64Buffer *buffer, const int w, const uint8_t opcode, const int reg, const X64Mem m) {
+    emit_rex_mem(buffer, w, reg, m);
+    x64_byte(buffer, opcode);
+    emit_modrm_mem(buffer, reg, m);
+}
+
+void x64_mov_rr(X64Buffer *buffer, const X64Reg dst, const X64Reg src) {
+    emit_rr(buffer, 0x89, src, dst);
+}
+
+void x64_mov_ri(X64Buffer *buffer, const X64Reg dst, const int64_t imm) {
+    if (imm >= INT32_MIN && imm <= INT32_MAX) {
+        // mov r/m64, imm32 (sign extended)
+        emit_rex(buffer, 1, 0, 0, dst);
+        x64_byte(buffer, 0xC7);
+        emit_modrm_reg(buffer, 0, dst);
+        x64_u32(buffer, (uint32_t)imm);
+    } else {
+        emit_rex(buffer, 1, 0, 0, dst);
+        x64_byte(buffer, (uint8_t)(0xB8 | (dst & 7)));
+        x64_u64(buffer, (uint64_t)imm);
+    }
+}
+
+void x64_mov_rm(X64Buffer *buffer, const X64Reg dst, const X64Mem src) {
+    emit_rm(buffer, 1, 0x8B, dst, src);
+}
+
+void x64_mov_mr(X64Buffer *buffer, const X64Mem dst, const X64Reg src) {
+    emit_rm(buffer, 1, 0x89, src, dst);
+}
+
+void x64_mov_mi(X64Buffer *buffer, const X64Mem dst, const int32_t imm) {
+    emit_rm(buffer, 1, 0xC7, 0, dst);
+    x64_u32(buffer, (uint32_t)imm);
+}
+
+void x64_mov32_mr(X64Buffer *buffer, const X64Mem dst, const X64Reg src) {
+    emit_rm(buffer, 0, 0x89, src, dst);
+}
+
+void x64_movsxd_rm(X64Buffer *buffer, const X64Reg dst, const X64Mem src) {
+    emit_rm(buffer, 1, 0x63, dst, src);
+}
+
+void x64_lea(X64Buffer *buffer, const X64Reg dst, const X64Mem src) {
+    emit_rm(buffer, 1, 0x8D, dst, src);
+}
+
+// lea dst, [rip + rel32]; returns the offset of rel32 for x64_patch_rel32
+size_t x64_lea_rip(X64Buffer *buffer, const X64Reg dst) {
+    emit_rex(buffer, 1, dst, 0, 0);
+    x64_byte(buffer, 0x8D);
+    x64_byte(buffer, (uint8_t)((dst & 7) << 3 | 5));
+    const size_t at = buffer->length;
+    x64_u32(buffer, 0);
+    return at;
+}
+
+void x64_alu_rr(X64Buffer *buffer, const X64Alu op, const X64Reg dst, const X64Reg src) {
+    emit_rr(buffer, (uint8_t)op, src, dst);
+}
+
+void x64_alu_ri(X64Buffer *buffer, const X64Alu op, const X64Reg dst, const int32_t imm) {
+    // The ModRM extension of the immediate form is the r/m opcode / 8
+    const int extension = op >> 3;
+    emit_rex(buffer, 1, 0, 0, dst);
+    if (imm >= -128 && imm <= 127) {
+        x64_byte(buffer, 0x83);
+        emit_modrm_reg(buffer, extension, dst);
+        x64_byte(buffer, (uint8_t)imm);
+    } else {
+        x64_byte(buffer, 0x81);
+        emit_modrm_reg(buffer, extension, dst);
+        x64_u32(buffer, (uint32_t)imm);
+    }
+}
+
+void x64_test_rr(X64Buffer *buffer, const X64Reg a, const X64Reg b) {
+    emit_rr(buffer, 0x85, b, a);
+}
+
+void x64_test_ri(X64Buffer *buffer, const X64Reg reg, const int32_t imm) {
+    emit_rex(buffer, 1, 0, 0, reg);
+    x64_byte(buffer, 0xF7);
+    emit_modrm_reg(buffer, 0, reg);
+    x64_u32(buffer, (uint32_t)imm);
+}
+
+void x64_shift_ri(X64Buffer *buffer, const X64Shift op, const X64Reg reg, const uint8_t count) {
+    emit_rex(buffer, 1, 0, 0, reg);
+    x64_byte(buffer, 0xC1);
+    emit_modrm_reg(buffer, op, reg);
+    x64_byte(buffer, count);
+}
+
+void x64_imul_rr(X64Buffer *buffer, const X64Reg dst, const X64Reg src) {
+    emit_rex(buffer, 1, dst, 0, src);
+    x64_byte(buffer, 0x0F);
+    x64_byte(buffer, 0xAF);
+    emit_modrm_reg(buffer, dst, src);
+}
+
+void x64_cqo(X64Buffer *buffer) {
+    x64_byte(buffer, 0x48);
+    x64_byte(buffer, 0x99);
+}
+
+void x64_idiv_r(X64Buffer *buffer, const X64Reg divisor) {
+    emit_rex(buffer, 1, 0, 0, divisor);
+    x64_byte(buffer, 0xF7);
+    emit_modrm_reg(buffer, 7, divisor);
+}
+
+// Jumps with a rel32 to be patched; they return the offset of rel32
+size_t x64_jcc(X64Buffer *buffer, const X64Cond cond) {
+    x64_byte(buffer, 0x0F);
+    x64_byte(buffer, (uint8_t)(0x80 | cond));
+    const size_t at = buffer->length;
+    x64_u32(buffer, 0);
+    return at;
+}
+
+size_t x64_jmp(X64Buffer *buffer) {
+    x64_byte(buffer, 0xE9);
+    const size_t at = buffer->length;
+    x64_u32(buffer, 0);
+    return at;
+}
+
+void x64_jmp_m(X64Buffer *buffer, const X64Mem target) {
+    emit_rm(buffer, 0, 0xFF, 4, target);
+}
+
+void x64_call_r(X64Buffer *buffer, const X64Reg target) {
+    emit_rex(buffer, 0, 0, 0, target);
+    x64_byte(buffer, 0xFF);
+    emit_modrm_reg(buffer, 2, target);
+}
+
+void x64_push_r(X64Buffer *buffer, const X64Reg reg) {
+    emit_rex(buffer, 0, 0, 0, reg);
+    x64_byte(buffer, (uint8_t)(0x50 | (reg & 7)));
+}
+
+void x64_pop_r(X64Buffer *buffer, const X64Reg reg) {
+    emit_rex(buffer, 0, 0, 0, reg);
+    x64_byte(buffer, (uint8_t)(0x58 | (reg & 7)));
+}
+
+void x64_ret(X64Buffer *buffer) {
+    x64_byte(buffer, 0xC3);
+}
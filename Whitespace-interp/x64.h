@@ -0,0 +1,97 @@
+//
+// Created by IWOFLEUR on 16.10.2026.
+//
+
+#ifndef X64_H
+#define X64_H
+
+// Minimal x86-64 encoder: just the instruction forms the JIT emits.
+// All operations are 64-bit unless the name says otherwise.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    X64_RAX, X64_RCX, X64_RDX, X64_RBX, X64_RSP, X64_RBP, X64_RSI, X64_RDI,
+    X64_R8, X64_R9, X64_R10, X64_R11, X64_R12, X64_R13, X64_R14, X64_R15,
+    X64_NONE = -1
+} X64Reg;
+
+// Condition codes for jcc
+typedef enum {
+    X64_CC_O = 0x0, X64_CC_NO = 0x1, X64_CC_B = 0x2, X64_CC_AE = 0x3,
+    X64_CC_E = 0x4, X64_CC_NE = 0x5, X64_CC_BE = 0x6, X64_CC_A = 0x7,
+    X64_CC_S = 0x8, X64_CC_NS = 0x9, X64_CC_L = 0xC, X64_CC_GE = 0xD,
+    X64_CC_LE = 0xE, X64_CC_G = 0xF
+} X64Cond;
+
+// Two-operand ALU instructions, as their "r/m, reg" opcode
+typedef enum {
+    X64_ADD = 0x01, X64_OR = 0x09, X64_AND = 0x21, X64_SUB = 0x29,
+    X64_XOR = 0x31, X64_CMP = 0x39
+} X64Alu;
+
+// Shifts, as their ModRM opcode extension
+typedef enum {
+    X64_SHL = 4, X64_SHR = 5, X64_SAR = 7
+} X64Shift;
+
+// Memory operand [base + index * scale + disp]
+typedef struct {
+    X64Reg base;
+    X64Reg index;
+    int scale;                  // 1, 2, 4 or 8
+    int32_t disp;
+} X64Mem;
+
+typedef struct {
+    uint8_t* bytes;
+    size_t length;
+    size_t capacity;
+    bool failed;                // An allocation failed, the contents are unusable
+} X64Buffer;
+
+static inline X64Mem x64_mem(const X64Reg base, const int32_t disp) {
+    return (X64Mem){base, X64_NONE, 1, disp};
+}
+
+static inline X64Mem x64_mem_index(const X64Reg base, const X64Reg index, const int scale, const int32_t disp) {
+    return (X64Mem){base, index, scale, disp};
+}
+
+void x64_init(X64Buffer *buffer);
+void x64_free(X64Buffer *buffer);
+void x64_byte(X64Buffer *buffer, uint8_t byte);
+void x64_u32(X64Buffer *buffer, uint32_t value);
+void x64_u64(X64Buffer *buffer, uint64_t value);
+void x64_patch_rel32(X64Buffer *buffer, size_t at, size_t target);
+
+void x64_mov_rr(X64Buffer *buffer, X64Reg dst, X64Reg src);
+void x64_mov_ri(X64Buffer *buffer, X64Reg dst, int64_t imm);
+void x64_mov_rm(X64Buffer *buffer, X64Reg dst, X64Mem src);
+void x64_mov_mr(X64Buffer *buffer, X64Mem dst, X64Reg src);
+void x64_mov_mi(X64Buffer *buffer, X64Mem dst, int32_t imm);
+void x64_mov32_mr(X64Buffer *buffer, X64Mem dst, X64Reg src);
+void x64_movsxd_rm(X64Buffer *buffer, X64Reg dst, X64Mem src);
+void x64_lea(X64Buffer *buffer, X64Reg dst, X64Mem src);
+size_t x64_lea_rip(X64Buffer *buffer, X64Reg dst);
+
+void x64_alu_rr(X64Buffer *buffer, X64Alu op, X64Reg dst, X64Reg src);
+void x64_alu_ri(X64Buffer *buffer, X64Alu op, X64Reg dst, int32_t imm);
+void x64_test_rr(X64Buffer *buffer, X64Reg a, X64Reg b);
+void x64_test_ri(X64Buffer *buffer, X64Reg reg, int32_t imm);
+void x64_shift_ri(X64Buffer *buffer, X64Shift op, X64Reg reg, uint8_t count);
+void x64_imul_rr(X64Buffer *buffer, X64Reg dst, X64Reg src);
+void x64_cqo(X64Buffer *buffer);
+void x64_idiv_r(X64Buffer *buffer, X64Reg divisor);
+
+size_t x64_jcc(X64Buffer *buffer, X64Cond cond);
+size_t x64_jmp(X64Buffer *buffer);
+void x64_jmp_m(X64Buffer *buffer, X64Mem target);
+void x64_call_r(X64Buffer *buffer, X64Reg target);
+void x64_push_r(X64Buffer *buffer, X64Reg reg);
+void x64_pop_r(X64Buffer *buffer, X64Reg reg);
+void x64_ret(X64Buffer *buffer);
+
+#endif //X64_H